@@ -0,0 +1,59 @@
+-- Smooth and de-spike axes natively, at device rate.
+--
+-- `joystick:Channel(axis)` collects every sample the device reported since the
+-- last update, with timestamps. Filters run over each sample as it arrives,
+-- so their output doesn't depend on how often callbacks run.
+
+Configure {
+    requires = {
+        { vendor_id = 0x0483, product_id = 0x5710 }, -- FrSky Taranis Joystick
+    },
+
+    -- Optional LuaJIT tuning for this script alone (`off = true` disables the JIT).
+    -- Traces and aborts are shown in the GUI, `profile` also samples how much time
+    -- runs in compiled traces, for one script at a time. Profiling runs a 1 ms
+    -- sampling timer for as long as the script is loaded, so only enable it while
+    -- investigating.
+    jit = { hotloop = 56, maxtrace = 1000, --[[ profile = true ]] },
+}
+
+local input = FindJoystick(0x0483, 0x5710)
+
+-- Drop +-2 LSB jitter from every axis before it can wake this script, and
+-- re-centre a rudder pot that rests slightly off zero
+input:SetNoiseGate { threshold = 2 }
+input:SetNoiseGate { axis = 3, threshold = 4, offset = -180 }
+
+local output = CreateVirtualJoystick {
+    name = "Virtual Filtered Stick",
+    num_axes = 4,
+}
+
+local roll     = input:Channel(0)
+local pitch    = input:Channel(1)
+local throttle = input:Channel(2)
+local rudder   = input:Channel(3)
+
+-- Jitter free when held still, without lag when moving quickly
+local roll_filtered = OneEuroFilter { input = roll, min_cutoff = 1.0, beta = 0.05 }
+
+-- Remove single sample spikes from a noisy potentiometer
+local pitch_filtered = MedianFilter { input = pitch, window = 5 }
+
+-- Limit throttle changes to 2 full deflections per second
+local throttle_filtered = SlewFilter { input = throttle, rate = 2.0 }
+
+-- Simple smoothing with a 50ms time constant
+local rudder_filtered = EMAFilter { input = rudder, time_constant = 0.05 }
+
+Register(function()
+    output:SetAxis(0, roll_filtered:Get())
+    output:SetAxis(1, pitch_filtered:Get())
+    output:SetAxis(2, throttle_filtered:Get())
+    output:SetAxis(3, rudder_filtered:Get())
+
+    -- Raw samples remain available, e.g. to measure the device's report rate
+    for i = 1, roll:Count() do
+        local value, time = roll:Sample(i)
+    end
+end)
@@ -0,0 +1,39 @@
+-- Forward force feedback from a virtual wheel to the rumble motors of a gamepad.
+--
+-- Without a target the effects are consumed locally, which is useful for
+-- measuring round trip times with a stand-in application such as:
+--   $ fftest /dev/input/by-id/<virtual wheel>
+-- Round trip times are shown in the Virtual Joysticks panel in GUI mode.
+
+local output = CreateVirtualJoystick {
+    name = "Virtual FFB Wheel",
+    num_axes = 3,
+    num_buttons = 4,
+    force_feedback = true,
+}
+
+local routed = false
+
+Register(function()
+    local input = FindJoystick(0x18d1, 0x9400) -- Google Stadia Controller
+    if not input then
+        if routed then
+            output:RouteForceFeedback {}
+            routed = false
+        end
+        return
+    end
+
+    if not routed then
+        output:RouteForceFeedback {
+            target = input,
+            scale = 0.75,
+            swap_motors = false,
+        }
+        routed = true
+    end
+
+    output:SetAxis(0, input:GetAxis(0))
+    output:SetAxis(1, input:GetAxis(5))
+    output:SetAxis(2, input:GetAxis(4))
+end)
@@ -0,0 +1,41 @@
+-- Chord keyboard keys with joystick buttons, and turn mouse motion into a virtual axis.
+--
+-- Keyboards and mice are read through evdev. With `grab = true` their events
+-- are not seen by other applications. A file of raw recorded `input_event`
+-- records (e.g. captured with `cat /dev/input/eventN > capture.bin`) can be
+-- used as `path` to replay input without the physical device.
+
+local keyboard = OpenInputDevice {
+    path = "/dev/input/by-id/usb-Keyboard-event-kbd",
+    grab = false,
+}
+
+local mouse = OpenInputDevice {
+    path = "/dev/input/by-id/usb-Mouse-event-mouse",
+    grab = true,
+}
+
+local output = CreateVirtualJoystick {
+    name = "Virtual Stick",
+    num_axes = 2,
+    num_buttons = 2,
+}
+
+local x, y = 0, 0
+local sensitivity = 0.002
+
+Register(function()
+    local dx, dy = mouse:GetRelative()
+    x = math.max(-1, math.min(1, x + dx * sensitivity))
+    y = math.max(-1, math.min(1, y + dy * sensitivity))
+    if mouse:GetButton(2) then x, y = 0, 0 end
+
+    output:SetAxis(0, x)
+    output:SetAxis(1, y)
+
+    local input = FindJoystick(0x0483, 0x5710) -- FrSky Taranis Joystick
+    local trigger = input and input:GetButton(0) or false
+
+    output:SetButton(0, trigger and keyboard:GetKey("LEFTSHIFT"))
+    output:SetButton(1, keyboard:WasPressed("SPACE"))
+end)
@@ -0,0 +1,52 @@
+-- Toggles, chords, layers and press detection without hand-written state machines.
+--
+-- Logic primitives are evaluated natively whenever one of their inputs changes,
+-- so callbacks only need to read their results. Inputs are `joystick:Button(i)`,
+-- `device:Key(name)` or another primitive.
+
+Configure {
+    requires = {
+        { vendor_id = 0x0483, product_id = 0x5710 }, -- FrSky Taranis Joystick
+    },
+}
+
+local input = FindJoystick(0x0483, 0x5710)
+
+local output = CreateVirtualJoystick {
+    name = "Virtual HOTAS",
+    num_axes = 2,
+    num_buttons = 8,
+}
+
+-- Flips between on and off with each press
+local gear = Toggle { input = input:Button(0) }
+
+-- Only active while both buttons are held
+local eject = Chord { input:Button(1), input:Button(2) }
+
+-- Holding button 3 or 4 selects layer 1 or 2, otherwise layer 0
+local layer = Layer { input:Button(3), input:Button(4) }
+
+-- Distinguishes taps, double taps and long presses of a single button
+local press = PressDetector { input = input:Button(5), long_press = 0.5, double_tap = 0.25 }
+
+-- Button 6 reports separately depending on whether button 7 was held when it was pressed
+local shift = Shift { modifier = input:Button(7), input = input:Button(6) }
+
+Register(function()
+    local stick = FindJoystick(0x0483, 0x5710)
+    if not stick then return end
+
+    -- Route the stick's X axis to a different output depending on the layer
+    local x = stick:GetAxis(0)
+    output:SetAxis(0, layer:GetLayer() == 0 and x or 0)
+    output:SetAxis(1, layer:GetLayer() == 1 and x or 0)
+
+    output:SetButton(0, gear:Get())
+    output:SetButton(1, eject:Get())
+    output:SetButton(2, press:IsLongPress())
+    output:SetButton(3, press:WasTap())
+    output:SetButton(4, press:WasDoubleTap())
+    output:SetButton(5, shift:Get())
+    output:SetButton(6, shift:IsShifted())
+end)
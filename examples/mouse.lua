@@ -0,0 +1,51 @@
+-- Drive a virtual mouse and keyboard from a gamepad, for games without joystick support.
+--
+-- Mouse motion is set as a velocity and integrated natively at `tick_rate`,
+-- so smooth motion does not require a callback for every report.
+
+-- Stay dormant, with no virtual devices, until the gamepad is connected
+Configure {
+    requires = {
+        { vendor_id = 0x18d1, product_id = 0x9400 }, -- Google Stadia Controller
+    },
+    release_devices = true,
+}
+
+local mouse = CreateVirtualMouse {
+    name = "Virtual Mouse",
+    tick_rate = 1000,
+}
+
+local keyboard = CreateVirtualKeyboard {
+    name = "Virtual Keyboard",
+}
+
+local speed = 1500 -- counts per second at full deflection
+
+function deadzone(v, inner)
+    if math.abs(v) < inner then return 0 end
+    return v
+end
+
+Register(function()
+    local input = FindJoystick(0x18d1, 0x9400) -- Google Stadia Controller
+    if not input then
+        mouse:SetVelocity(0, 0)
+        return
+    end
+
+    local x = deadzone(input:GetAxis(2), 0.1)
+    local y = deadzone(input:GetAxis(3), 0.1)
+    mouse:SetVelocity(x * speed, y * speed)
+
+    mouse:SetButton(0, input:GetAxis(5) > 0.5)
+    mouse:SetButton(1, input:GetAxis(4) > 0.5)
+
+    local lx = input:GetAxis(0)
+    local ly = input:GetAxis(1)
+    keyboard:SetKey("W", ly < -0.5)
+    keyboard:SetKey("S", ly >  0.5)
+    keyboard:SetKey("A", lx < -0.5)
+    keyboard:SetKey("D", lx >  0.5)
+    keyboard:SetKey("SPACE", input:GetButton(0))
+end)
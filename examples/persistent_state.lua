@@ -0,0 +1,38 @@
+-- Settings that survive script reloads and restarts.
+--
+-- PersistentState() returns a per-script store backed by a memory mapped file.
+-- Reading and writing fields are plain memory accesses, and a crash mid-write
+-- keeps the previous value. Values are numbers, booleans or short strings.
+-- Stores live in Mapper's preferences directory, or in $MAPPER_STATE_DIR when set.
+
+local input = FindJoystick(0x0483, 0x5710) -- FrSky Taranis Joystick
+if not input then return end
+
+local output = CreateVirtualJoystick {
+    name = "Virtual Wheel",
+    num_axes = 1,
+    num_buttons = 0,
+}
+
+local state = PersistentState()
+
+-- Defaults only apply the first time the script runs
+state.gamma = state.gamma or 1.0
+
+local was_pressed = { false, false }
+
+Register(function()
+    -- Buttons 0 and 1 tune the steering curve, the chosen value is kept across sessions
+    for i, step in ipairs { -0.1, 0.1 } do
+        local pressed = input:GetButton(i - 1)
+        if pressed and not was_pressed[i] then
+            state.gamma = math.max(0.2, math.min(3.0, state.gamma + step))
+            print("Steering gamma: " .. state.gamma)
+        end
+        was_pressed[i] = pressed
+    end
+
+    local x = input:GetAxis(0)
+    local sign = x < 0 and -1 or 1
+    output:SetAxis(0, sign * math.abs(x) ^ state.gamma)
+end)
@@ -0,0 +1,159 @@
+#include "arena.hpp"
+
+#include <cstdlib>
+#include <cstring>
+#include <algorithm>
+
+static
+size_t SizeClassIndex(size_t size)
+{
+    return (size - 1) / ScriptArena::granularity;
+}
+
+ScriptArena::~ScriptArena()
+{
+    Release();
+}
+
+void* ScriptArena::Allocate(size_t size)
+{
+    auto max = limit.Get();
+    if (max && live.Get() + size > max) {
+        failed_allocations.Add(1);
+        return nullptr;
+    }
+
+    void* ptr;
+
+    if (size <= max_small_size) {
+        auto index = SizeClassIndex(size);
+        auto block_size = (index + 1) * granularity;
+
+        if (auto block = free_lists[index]) {
+            free_lists[index] = block->next;
+            ptr = block;
+        } else {
+            if (bump + block_size > bump_end) {
+                auto chunk = static_cast<std::byte*>(std::malloc(chunk_size));
+                if (!chunk) {
+                    failed_allocations.Add(1);
+                    return nullptr;
+                }
+                chunks.emplace_back(chunk);
+                reserved.Add(chunk_size);
+                bump = chunk;
+                bump_end = chunk + chunk_size;
+            }
+            ptr = bump;
+            bump += block_size;
+        }
+    } else {
+        auto block = static_cast<LargeBlock*>(std::malloc(sizeof(LargeBlock) + size));
+        if (!block) {
+            failed_allocations.Add(1);
+            return nullptr;
+        }
+        block->prev = nullptr;
+        block->next = large_blocks;
+        block->size = size;
+        if (large_blocks) large_blocks->prev = block;
+        large_blocks = block;
+        reserved.Add(sizeof(LargeBlock) + size);
+        ptr = block + 1;
+    }
+
+    live.Add(size);
+    peak.Set(std::max(peak.Get(), live.Get()));
+
+    return ptr;
+}
+
+void ScriptArena::Free(void* ptr, size_t size)
+{
+    if (!ptr || releasing) return;
+
+    live.Sub(size);
+
+    if (size <= max_small_size) {
+        auto index = SizeClassIndex(size);
+        auto block = static_cast<FreeBlock*>(ptr);
+        block->next = free_lists[index];
+        free_lists[index] = block;
+    } else {
+        auto block = static_cast<LargeBlock*>(ptr) - 1;
+        if (block->prev) block->prev->next = block->next;
+        else             large_blocks = block->next;
+        if (block->next) block->next->prev = block->prev;
+        reserved.Sub(sizeof(LargeBlock) + block->size);
+        std::free(block);
+    }
+}
+
+void* ScriptArena::Reallocate(void* ptr, size_t old_size, size_t new_size)
+{
+    if (!ptr) return Allocate(new_size);
+
+    // Blocks that stay within the same size class can be reused in place
+    if (old_size <= max_small_size && new_size <= max_small_size
+            && SizeClassIndex(old_size) == SizeClassIndex(new_size)) {
+        auto max = limit.Get();
+        if (new_size > old_size && max && live.Get() + (new_size - old_size) > max) {
+            failed_allocations.Add(1);
+            return nullptr;
+        }
+        live.Set(live.Get() - old_size + new_size);
+        peak.Set(std::max(peak.Get(), live.Get()));
+        return ptr;
+    }
+
+    // Lua requires that shrinking never fails, so bypass the limit
+    auto saved_limit = limit.Get();
+    if (new_size < old_size) limit.Set(0);
+    auto new_ptr = Allocate(new_size);
+    limit.Set(saved_limit);
+
+    if (!new_ptr) {
+        if (new_size > old_size) return nullptr;
+
+        // Out of memory entirely, keep the original block and leave its tail unused
+        live.Sub(old_size - new_size);
+        return ptr;
+    }
+
+    std::memcpy(new_ptr, ptr, std::min(old_size, new_size));
+    Free(ptr, old_size);
+
+    return new_ptr;
+}
+
+void ScriptArena::Release()
+{
+    for (auto* chunk : chunks) {
+        std::free(chunk);
+    }
+    chunks.clear();
+
+    while (large_blocks) {
+        auto next = large_blocks->next;
+        std::free(large_blocks);
+        large_blocks = next;
+    }
+
+    free_lists = {};
+    bump = bump_end = nullptr;
+    live.Set(0);
+    reserved.Set(0);
+    releasing = false;
+}
+
+void* ScriptArena::LuaAlloc(void* userdata, void* ptr, size_t old_size, size_t new_size)
+{
+    auto arena = static_cast<ScriptArena*>(userdata);
+
+    if (new_size == 0) {
+        arena->Free(ptr, old_size);
+        return nullptr;
+    }
+
+    return arena->Reallocate(ptr, old_size, new_size);
+}
@@ -0,0 +1,77 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+//          Script Arena
+// -----------------------------------------------------------------------------
+
+// Per-script allocator for Lua states. Small allocations are served from
+// size-class free lists carved out of large chunks, larger allocations fall
+// back to malloc but are tracked so that the whole arena can be released at
+// once when the script is torn down.
+
+// Only the thread running the script writes the counters, state publishing and
+// telemetry read them from other threads
+struct ArenaCounter
+{
+    std::atomic<size_t> value = 0;
+
+    size_t Get() const { return value.load(std::memory_order_relaxed); }
+    void Set(size_t v) { value.store(v, std::memory_order_relaxed); }
+    void Add(size_t n) { Set(Get() + n); }
+    void Sub(size_t n) { Set(Get() - n); }
+};
+
+struct ScriptArena
+{
+    static constexpr size_t chunk_size = 256 * 1024;
+    static constexpr size_t granularity = 16;
+    static constexpr size_t max_small_size = 512;
+    static constexpr size_t num_size_classes = max_small_size / granularity;
+
+    struct FreeBlock
+    {
+        FreeBlock* next;
+    };
+
+    struct alignas(16) LargeBlock
+    {
+        LargeBlock* prev;
+        LargeBlock* next;
+        size_t size;
+    };
+
+    std::array<FreeBlock*, num_size_classes> free_lists = {};
+    std::vector<void*> chunks;
+    std::byte* bump = nullptr;
+    std::byte* bump_end = nullptr;
+    LargeBlock* large_blocks = nullptr;
+
+    // 0 = unlimited
+    ArenaCounter limit;
+
+    ArenaCounter live;
+    ArenaCounter peak;
+    ArenaCounter reserved;
+    ArenaCounter failed_allocations;
+
+    // While releasing, frees are ignored as the backing memory is returned in bulk
+    bool releasing = false;
+
+    ScriptArena() = default;
+    ScriptArena(const ScriptArena&) = delete;
+    ScriptArena& operator=(const ScriptArena&) = delete;
+    ~ScriptArena();
+
+    void* Allocate(size_t size);
+    void Free(void* ptr, size_t size);
+    void* Reallocate(void* ptr, size_t old_size, size_t new_size);
+    void Release();
+
+    static void* LuaAlloc(void* userdata, void* ptr, size_t old_size, size_t new_size);
+};
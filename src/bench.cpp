@@ -0,0 +1,238 @@
+#include "mapper.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <cstdlib>
+#include <new>
+#include <ranges>
+
+// -----------------------------------------------------------------------------
+//          Scripting Boundary Microbenchmarks
+// -----------------------------------------------------------------------------
+
+// Isolates the cost of each step between the engine and Lua scripts. Input
+// comes from an SDL virtual joystick and all virtual devices use the null
+// output path, so results are independent of any attached hardware.
+//
+// Lua side benchmarks run their loop inside Lua, subtract the "empty loop"
+// result to get the cost of the call itself.
+
+constexpr uint16_t bench_vendor_id = 0x1209;
+constexpr uint16_t bench_product_id = 0x4D50;
+
+// -----------------------------------------------------------------------------
+//          Allocation Counting
+// -----------------------------------------------------------------------------
+
+static std::atomic<uint64_t> heap_allocations = 0;
+static uint64_t lua_allocations = 0;
+
+void* operator new(size_t size)
+{
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (auto ptr = std::malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc();
+}
+
+void operator delete(void* ptr) noexcept
+{
+    std::free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    std::free(ptr);
+}
+
+struct LuaAllocator
+{
+    lua_Alloc alloc;
+    void* userdata;
+};
+
+static
+void* CountingLuaAlloc(void* userdata, void* ptr, size_t old_size, size_t new_size)
+{
+    // Fresh allocations and growing reallocations, old_size is a type tag when ptr is null
+    if (new_size && (!ptr || new_size > old_size)) ++lua_allocations;
+    auto allocator = static_cast<LuaAllocator*>(userdata);
+    return allocator->alloc(allocator->userdata, ptr, old_size, new_size);
+}
+
+// -----------------------------------------------------------------------------
+//          Harness
+// -----------------------------------------------------------------------------
+
+template<typename Fn>
+void Bench(std::string_view name, uint64_t iterations, Fn&& fn)
+{
+    // Warm up caches, JIT traces and any lazily created state
+    fn(std::max<uint64_t>(iterations / 100, 1));
+
+    auto heap_start = heap_allocations.load(std::memory_order_relaxed);
+    auto lua_start = lua_allocations;
+    auto start = std::chrono::steady_clock::now();
+
+    fn(iterations);
+
+    auto end = std::chrono::steady_clock::now();
+    auto heap = heap_allocations.load(std::memory_order_relaxed) - heap_start;
+    auto lua = lua_allocations - lua_start;
+
+    auto ns = std::chrono::duration<double, std::nano>(end - start).count() / double(iterations);
+    std::cout << std::format("{:<40} {:>10.1f} ns/op {:>8.2f} heap allocs/op {:>8.2f} lua allocs/op\n",
+        name, ns, double(heap) / double(iterations), double(lua) / double(iterations));
+}
+
+static
+SDL_Joystick* AttachBenchJoystick()
+{
+    SDL_VirtualJoystickDesc desc;
+    SDL_INIT_INTERFACE(&desc);
+    desc.type = SDL_JOYSTICK_TYPE_GAMEPAD;
+    desc.naxes = 6;
+    desc.nbuttons = 16;
+    desc.vendor_id = bench_vendor_id;
+    desc.product_id = bench_product_id;
+    desc.name = "Mapper Bench Joystick";
+
+    auto id = SDL_AttachVirtualJoystick(&desc);
+    if (!id) Error("Failed to attach virtual joystick: {}", SDL_GetError());
+
+    auto joystick = SDL_OpenJoystick(id);
+    if (!joystick) Error("Failed to open virtual joystick: {}", SDL_GetError());
+
+    SDL_SetJoystickVirtualAxis(joystick, 0, 12345);
+    SDL_UpdateJoysticks();
+
+    joysticks.insert(joystick);
+
+    return joystick;
+}
+
+static
+Script* LoadBenchScript()
+{
+    auto path = std::filesystem::temp_directory_path() / "mapper-bench.lua";
+    std::ofstream(path) << std::format(R"(
+local joystick = FindJoystick({0}, {1})
+local vjoy = CreateVirtualJoystick {{ name = "Mapper Bench", num_axes = 8, num_buttons = 32 }}
+
+Register(function() end)
+
+function BenchEmptyLoop(n)
+    for i = 1, n do end
+end
+
+function BenchGetAxis(n)
+    for i = 1, n do joystick:GetAxis(0) end
+end
+
+function BenchSetAxis(n)
+    for i = 1, n do vjoy:SetAxis(0, 0.5) end
+end
+
+function BenchFindJoystick(n)
+    for i = 1, n do FindJoystick({0}, {1}) end
+end
+
+function BenchCreateVirtualJoystick(n)
+    for i = 1, n do
+        CreateVirtualJoystick {{ name = "Mapper Bench", num_axes = 8, num_buttons = 32, max_report_rate = 500 }}
+    end
+end
+)", bench_vendor_id, bench_product_id);
+
+    LoadScript(path);
+    std::filesystem::remove(path);
+
+    auto script = scripts.back();
+    if (script->disabled) Error("Failed to load benchmark script: {}", script->error);
+
+    return script;
+}
+
+// -----------------------------------------------------------------------------
+
+static
+int Main() try
+{
+    log_level = LogLevel::Warn;
+    null_output = true;
+
+    Initialize();
+    AttachBenchJoystick();
+    auto script = LoadBenchScript();
+
+    auto L = script->lua->lua_state();
+    LuaAllocator allocator;
+    allocator.alloc = lua_getallocf(L, &allocator.userdata);
+    lua_setallocf(L, &CountingLuaAlloc, &allocator);
+
+    constexpr uint64_t iterations = 1'000'000;
+
+    Bench("callback.call (empty callback)", iterations, [&](uint64_t n) {
+        auto& callback = script->callbacks.front();
+        for (uint64_t i = 0; i < n; ++i) {
+            auto res = callback.call();
+            if (!res.valid()) Error("Callback failed");
+        }
+    });
+
+    auto lua_bench = [&](std::string_view name, const char* function, uint64_t n) {
+        sol::protected_function fn = (*script->lua)[function];
+        Bench(name, n, [&](uint64_t count) {
+            auto res = fn(count);
+            if (!res.valid()) Error("{} failed: {}", function, res.get<sol::error>().what());
+        });
+    };
+
+    lua_bench("lua empty loop",                  "BenchEmptyLoop",             iterations);
+    lua_bench("Joystick:GetAxis",                "BenchGetAxis",               iterations);
+    lua_bench("VirtualJoystick:SetAxis",         "BenchSetAxis",               iterations);
+    lua_bench("FindJoystick",                    "BenchFindJoystick",          iterations);
+    lua_bench("CreateVirtualJoystick (null)",    "BenchCreateVirtualJoystick", iterations / 100);
+
+    // Drop the joysticks created above so that frames only present the script's own device
+    for (auto* vjoy : script->vjoysticks | std::views::drop(1)) vjoy->Destroy();
+    script->vjoysticks.resize(1);
+
+    Bench("SharedLockGuard shared", iterations, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            SharedLockGuard _{ engine_mutex, LockState::Shared };
+        }
+    });
+
+    Bench("SharedLockGuard shared -> unique", iterations, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            SharedLockGuard lock{ engine_mutex, LockState::Shared };
+            SharedLockGuard _{ lock, LockState::Unique };
+        }
+    });
+
+    Bench("engine frame (1 script)", iterations / 10, [&](uint64_t n) {
+        for (uint64_t i = 0; i < n; ++i) {
+            PushJoystickUpdateEvent();
+            ProcessEvents();
+            UpdateJoysticks();
+        }
+    });
+
+    UnloadAllScripts();
+    Shutdown();
+
+    return EXIT_SUCCESS;
+}
+catch (const std::exception& e)
+{
+    std::cerr << std::format("Exception: {}\n", e.what());
+    return EXIT_FAILURE;
+}
+
+int main()
+{
+    StartLogThread();
+    auto res = Main();
+    StopLogThread();
+    return res;
+}
@@ -0,0 +1,173 @@
+#include "mapper.hpp"
+
+#include <luajit.h>
+
+#include <fstream>
+#include <cstring>
+
+// -----------------------------------------------------------------------------
+
+struct BytecodeCacheHeader
+{
+    char magic[8];
+    uint64_t key;
+    uint64_t parse_ns;
+};
+
+constexpr char bytecode_cache_magic[8] = "MAPRBC1";
+
+static
+uint64_t HashFNV1a(std::string_view data, uint64_t hash = 0xcbf29ce484222325)
+{
+    for (auto c : data) {
+        hash ^= uint8_t(c);
+        hash *= 0x100000001b3;
+    }
+    return hash;
+}
+
+static
+std::optional<std::string> ReadFile(const std::filesystem::path& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file) return std::nullopt;
+    return std::string(std::istreambuf_iterator<char>(file), {});
+}
+
+static
+const std::filesystem::path& GetBytecodeCacheDir()
+{
+    static std::filesystem::path dir = [] {
+        auto pref_path = SDL_GetPrefPath("Mapper", "mapper");
+        if (!pref_path) {
+            LogWarn("Could not locate bytecode cache directory: {}", SDL_GetError());
+            return std::filesystem::path{};
+        }
+        std::filesystem::path path = pref_path;
+        SDL_free(pref_path);
+        path /= "bytecode";
+
+        std::error_code ec;
+        std::filesystem::create_directories(path, ec);
+        if (ec) {
+            LogWarn("Could not create bytecode cache directory: {}", ec.message());
+            return std::filesystem::path{};
+        }
+
+        return path;
+    }();
+    return dir;
+}
+
+// Entries are named <path hash>-<key>, so that writing a new entry for a script can drop
+// the ones left behind by earlier versions of it. Entries from before the path prefix are
+// dropped along the way.
+static
+void PruneBytecodeCache(const std::filesystem::path& dir, std::string_view prefix, const std::filesystem::path& keep)
+{
+    std::error_code ec;
+    for (std::filesystem::directory_iterator it(dir, ec), end; !ec && it != end; it.increment(ec)) {
+        auto& path = it->path();
+        if (path.extension() != ".ljbc" || path == keep) continue;
+
+        auto stem = path.stem().string();
+        bool stale = stem.starts_with(prefix) || stem.size() == 16;
+        std::error_code remove_ec;
+        if (stale && std::filesystem::remove(path, remove_ec)) {
+            LogDebug("Removed stale bytecode cache entry: {}", path.string());
+        }
+    }
+}
+
+static
+int WriteBytecode(lua_State*, const void* data, size_t size, void* userdata)
+{
+    static_cast<std::string*>(userdata)->append(static_cast<const char*>(data), size);
+    return 0;
+}
+
+// -----------------------------------------------------------------------------
+
+sol::load_result LoadScriptChunk(sol::state& lua, const std::filesystem::path& path)
+{
+    auto chunkname = "@" + path.string();
+
+    auto source = ReadFile(path);
+    if (!source) {
+        // Defer to Lua for a consistent error message
+        return lua.load_file(path.string());
+    }
+
+    auto& cache_dir = GetBytecodeCacheDir();
+    if (!bytecode_cache_enabled || cache_dir.empty()) {
+        return lua.load_buffer(source->data(), source->size(), chunkname, sol::load_mode::text);
+    }
+
+    // Bytecode embeds the chunkname and depends on the exact LuaJIT build
+    uint64_t key = HashFNV1a(LUAJIT_VERSION);
+    key = HashFNV1a(std::format("{}/{}", LUAJIT_VERSION_NUM, sizeof(void*)), key);
+    key = HashFNV1a(chunkname, key);
+    key = HashFNV1a(*source, key);
+
+    auto prefix = std::format("{:016x}-", HashFNV1a(chunkname));
+    auto cache_path = cache_dir / std::format("{}{:016x}.ljbc", prefix, key);
+
+    if (auto cached = ReadFile(cache_path); cached && cached->size() > sizeof(BytecodeCacheHeader)) {
+        BytecodeCacheHeader header;
+        std::memcpy(&header, cached->data(), sizeof(header));
+        if (std::memcmp(header.magic, bytecode_cache_magic, sizeof(header.magic)) == 0 && header.key == key) {
+            auto start = std::chrono::steady_clock::now();
+            auto chunk = lua.load_buffer(cached->data() + sizeof(header), cached->size() - sizeof(header), chunkname, sol::load_mode::binary);
+            auto load_time = std::chrono::steady_clock::now() - start;
+            if (chunk.valid()) {
+                ++bytecode_cache_hits;
+                auto parse_time = std::chrono::nanoseconds(header.parse_ns);
+                if (parse_time > load_time) bytecode_cache_saved += parse_time - load_time;
+                return chunk;
+            }
+            LogWarn("Discarding invalid bytecode cache entry: {}", cache_path.string());
+        }
+    }
+
+    ++bytecode_cache_misses;
+
+    auto start = std::chrono::steady_clock::now();
+    auto chunk = lua.load_buffer(source->data(), source->size(), chunkname, sol::load_mode::text);
+    auto parse_time = std::chrono::steady_clock::now() - start;
+    if (!chunk.valid()) return chunk;
+
+    // The freshly loaded function is on top of the stack
+    std::string bytecode;
+    BytecodeCacheHeader header = {};
+    std::memcpy(header.magic, bytecode_cache_magic, sizeof(header.magic));
+    header.key = key;
+    header.parse_ns = uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(parse_time).count());
+    bytecode.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    if (lua_dump(lua.lua_state(), WriteBytecode, &bytecode) != 0) {
+        LogWarn("Could not dump bytecode for: {}", path.string());
+        return chunk;
+    }
+
+    // Write to a temporary file first so that readers never observe partial entries
+    auto temp_path = cache_path;
+    temp_path += ".tmp";
+    {
+        std::ofstream file(temp_path, std::ios::binary | std::ios::trunc);
+        file.write(bytecode.data(), std::streamsize(bytecode.size()));
+        if (!file) {
+            LogWarn("Could not write bytecode cache entry: {}", temp_path.string());
+            return chunk;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp_path, cache_path, ec);
+    if (ec) {
+        LogWarn("Could not write bytecode cache entry: {}", ec.message());
+        std::filesystem::remove(temp_path, ec);
+        return chunk;
+    }
+
+    PruneBytecodeCache(cache_dir, prefix, cache_path);
+
+    return chunk;
+}
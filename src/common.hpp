@@ -2,20 +2,76 @@
 
 #include <format>
 #include <chrono>
-#include <iostream>
+#include <cstdint>
+#include <span>
+#include <algorithm>
+#include <atomic>
+#include <stdexcept>
+
+// -----------------------------------------------------------------------------
+//          Logging
+// -----------------------------------------------------------------------------
+
+// Messages are formatted straight into a slot of a lock-free ring and written
+// out by a background thread, so logging never blocks the caller. When the
+// ring is full messages are dropped and counted instead, and messages longer
+// than a slot are cut short with a marker.
+
+enum class LogLevel : uint8_t
+{
+    Debug,
+    Info,
+    Warn,
+    Error,
+};
+
+inline std::atomic<LogLevel> log_level = LogLevel::Info;
+
+struct LogSlot;
+
+LogSlot* AcquireLogSlot();
+std::span<char> GetLogSlotBuffer(LogSlot* slot);
+void CommitLogSlot(LogSlot* slot, LogLevel level, size_t length);
+
+// Reference counted, every StartLogThread needs a matching StopLogThread
+void StartLogThread();
+void StopLogThread();
+
+template<typename... Args>
+void LogAt(LogLevel level, std::format_string<Args...> fmt, Args&&... args)
+{
+    if (level < log_level.load(std::memory_order_relaxed)) return;
+    auto slot = AcquireLogSlot();
+    if (!slot) return;
+    auto buffer = GetLogSlotBuffer(slot);
+    auto res = std::format_to_n(buffer.data(), buffer.size(), fmt, std::forward<Args>(args)...);
+    CommitLogSlot(slot, level, size_t(res.size));
+}
 
 template<typename... Args>
 void Error(std::format_string<Args...> fmt, Args&&... args)
 {
     auto message = std::vformat(fmt.get(), std::make_format_args(args...));
-    std::cout << "[ERROR] " << message << '\n';
+    LogAt(LogLevel::Error, "{}", message);
     throw std::runtime_error(message);
 }
 
 template<typename... Args>
 void Log(std::format_string<Args...> fmt, Args&&... args)
 {
-    std::cout << std::vformat(fmt.get(), std::make_format_args(args...)) << '\n';
+    LogAt(LogLevel::Info, fmt, std::forward<Args>(args)...);
+}
+
+template<typename... Args>
+void LogDebug(std::format_string<Args...> fmt, Args&&... args)
+{
+    LogAt(LogLevel::Debug, fmt, std::forward<Args>(args)...);
+}
+
+template<typename... Args>
+void LogWarn(std::format_string<Args...> fmt, Args&&... args)
+{
+    LogAt(LogLevel::Warn, fmt, std::forward<Args>(args)...);
 }
 
 inline
@@ -52,6 +108,15 @@ std::string DurationToString(std::chrono::duration<double, std::nano> dur)
     return "0";
 }
 
+inline
+std::string BytesToString(uint64_t bytes)
+{
+    if (bytes >= 1024 * 1024 * 1024) return std::format("{:.2f}GiB", bytes / (1024.0 * 1024.0 * 1024.0));
+    if (bytes >= 1024 * 1024)        return std::format("{:.2f}MiB", bytes / (1024.0 * 1024.0));
+    if (bytes >= 1024)               return std::format("{:.2f}KiB", bytes / 1024.0);
+    return std::format("{}B", bytes);
+}
+
 template<typename Fn>
 struct Defer
 {
@@ -66,3 +131,11 @@ struct Defer
         fn();
     }
 };
+
+// -----------------------------------------------------------------------------
+//          Null Output
+// -----------------------------------------------------------------------------
+
+// When set, virtual devices are created without a backing OS device and their
+// reports are dropped after being encoded. Used for dry runs and benchmarks.
+inline bool null_output = false;
@@ -0,0 +1,54 @@
+#include "mapper.hpp"
+
+static CoreOptions core_options;
+
+void StartCore(const CoreOptions& options)
+{
+    StartLogThread();
+    core_options = options;
+
+    // Leave nothing half started, the caller may try again
+    try {
+        script_memory_limit = options.script_memory_limit;
+        bytecode_cache_enabled = options.bytecode_cache;
+        null_output = options.null_output;
+        if (options.trace_path) StartTracing(*options.trace_path);
+        MAPPER_TRACE_THREAD("Engine");
+        Initialize();
+        if (options.publish_state || options.daemon) state_region = CreateStateRegion(options.daemon);
+        if (options.daemon) StartCommandServer();
+        if (options.external_inputs) StartExternalInputServer();
+        if (options.telemetry_path) telemetry = OpenTelemetry(*options.telemetry_path);
+    } catch (...) {
+        StopCore();
+        throw;
+    }
+}
+
+bool RunCoreFrame()
+{
+    if (!ProcessEvents()) return false;
+    UpdateJoysticks();
+    PublishState();
+    return true;
+}
+
+void StopCore()
+{
+    // In reverse order of StartCore
+    if (telemetry) {
+        CloseTelemetry(telemetry);
+        telemetry = nullptr;
+    }
+    StopExternalInputServer();
+    StopCommandServer();
+    UnloadAllScripts();
+    if (state_region) {
+        DestroyStateRegion(state_region, core_options.daemon);
+        state_region = nullptr;
+        ResetStatePublishing();
+    }
+    Shutdown();
+    StopTracing();
+    StopLogThread();
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <cstddef>
+#include <filesystem>
+#include <optional>
+
+// -----------------------------------------------------------------------------
+//          Core
+// -----------------------------------------------------------------------------
+
+// Embedding API of the mapper_core library, used by both executables. The
+// engine runs on the thread that calls StartCore and RunCoreFrame. Scripts are
+// loaded from that thread, or from any thread with QueueCommand. StartCore
+// holds the log thread open until StopCore, which unloads all scripts and
+// undoes everything else StartCore did, so the core can be started again.
+
+struct CoreOptions
+{
+    // Default memory limit for each script, 0 = unlimited
+    size_t script_memory_limit = 0;
+    bool bytecode_cache = true;
+    bool null_output = false;
+    bool external_inputs = false;
+
+    // Publish engine state for an in-process GUI
+    bool publish_state = false;
+
+    // Publish engine state to shared memory and serve the command socket
+    bool daemon = false;
+
+    std::optional<std::filesystem::path> telemetry_path;
+    std::optional<std::filesystem::path> trace_path;
+};
+
+void StartCore(const CoreOptions& options);
+
+// Waits for input or a pending deadline and runs one engine update, returns false once quitting
+bool RunCoreFrame();
+
+void StopCore();
+
+void LoadScript(const std::filesystem::path& script_path);
+void UnloadScript(const std::filesystem::path& script_path);
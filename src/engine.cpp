@@ -1,7 +1,88 @@
 #include "mapper.hpp"
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <thread>
+
 bool joystick_event;
+
+// Set when only converging filters are due, which wakes just the scripts whose filtered values visibly moved
+bool filter_step;
 Uint32 joystick_update_event;
+Uint32 joystick_opened_event;
+
+// Opening a HID device and querying its capabilities can take tens of milliseconds,
+// so hotplugged joysticks are opened here and handed back to the engine thread as
+// a joystick_opened_event, which publishes them to scripts in one step.
+static struct
+{
+    std::mutex mutex;
+    std::condition_variable_any wake;
+    std::deque<SDL_JoystickID> pending;
+    std::jthread thread;
+} hotplug;
+
+static
+void OpenHotplugJoystick(SDL_JoystickID id)
+{
+    // SDL holds its global joystick lock for the whole open, which the engine thread still waits on
+    // when it pumps events or reads joysticks. Traces show the stall as engine spans ending with this one
+    MAPPER_TRACE_SPAN("Open Joystick");
+
+    if (auto joystick = SDL_OpenJoystick(id)) {
+        char guid[33];
+        SDL_GUIDToString(SDL_GetJoystickGUID(joystick), guid, sizeof(guid));
+        auto name = SDL_GetJoystickName(joystick);
+        auto serial = SDL_GetJoystickSerial(joystick);
+        Log("Joystick opened: {} ({} axes, {} buttons, {} hats, guid {}, serial {})",
+            name ? name : "unnamed",
+            SDL_GetNumJoystickAxes(joystick), SDL_GetNumJoystickButtons(joystick), SDL_GetNumJoystickHats(joystick),
+            guid, serial ? serial : "none");
+    } else {
+        LogWarn("Joystick added but could not open: {}", SDL_GetError());
+    }
+
+    // Always reply, the engine thread looks the joystick up again by id
+    SDL_Event event = {};
+    event.jdevice.type = joystick_opened_event;
+    event.jdevice.which = id;
+    SDL_PushEvent(&event);
+}
+
+static
+void StartHotplugThread()
+{
+    hotplug.thread = std::jthread([](std::stop_token stop) {
+        MAPPER_TRACE_THREAD("Hotplug");
+        for (;;) {
+            SDL_JoystickID id;
+            {
+                std::unique_lock lock{ hotplug.mutex };
+                if (!hotplug.wake.wait(lock, stop, [] { return !hotplug.pending.empty(); })) return;
+                id = hotplug.pending.front();
+                hotplug.pending.pop_front();
+            }
+            OpenHotplugJoystick(id);
+        }
+    });
+}
+
+static
+void StopHotplugThread()
+{
+    hotplug.thread = {};
+}
+
+static
+void QueueJoystickOpen(SDL_JoystickID id)
+{
+    {
+        std::scoped_lock _{ hotplug.mutex };
+        hotplug.pending.push_back(id);
+    }
+    hotplug.wake.notify_one();
+}
 
 void Initialize()
 {
@@ -10,88 +91,243 @@ void Initialize()
     SDL_SetJoystickEventsEnabled(true);
 
     joystick_update_event = SDL_RegisterEvents(1);
+    joystick_opened_event = SDL_RegisterEvents(1);
+
+    StartHotplugThread();
+}
+
+void Shutdown()
+{
+    StopHotplugThread();
+    hotplug.pending.clear();
+
+    for (auto* joystick : joysticks) {
+        SDL_CloseJoystick(joystick);
+    }
+    joysticks.clear();
+    noise_gates = {};
+
+    button_changes.clear();
+    axis_samples.clear();
+    output_deadline = std::nullopt;
+    logic_deadline = std::nullopt;
+    filter_deadline = std::nullopt;
+    frame = 0;
+
+    // Scripts are unloaded, nothing is left to claim pooled devices back
+    TrimVirtualJoystickPool(std::chrono::steady_clock::time_point::max());
+    vjoystick_pool_deadline = std::nullopt;
+
+    SDL_Quit();
+}
+
+static
+bool NextEvent(SDL_Event* event, bool wait)
+{
+    if (!wait) return SDL_PollEvent(event);
+
+    auto deadline = output_deadline;
+    for (auto& other : { state_publish_deadline, logic_deadline, filter_deadline, vjoystick_pool_deadline }) {
+        if (other && (!deadline || *other < *deadline)) deadline = other;
+    }
+    MAPPER_TRACE_SPAN("Wait For Events");
+
+    if (!deadline) return SDL_WaitEvent(event);
+
+    // Wake up in time to flush paced virtual joystick reports, pending GUI state and logic timers
+    auto remaining = std::chrono::ceil<std::chrono::milliseconds>(*deadline - std::chrono::steady_clock::now());
+    return SDL_WaitEventTimeout(event, Sint32(std::max<int64_t>(remaining.count(), 0)));
 }
 
 bool ProcessEvents()
 {
+    MAPPER_TRACE_SPAN("Process Events");
+
     bool wait = frame++ > 1;
 
     joystick_event = false;
+    filter_step = false;
+    bool joysticks_changed = false;
 
     SDL_Event event;
-    while (wait ? SDL_WaitEvent(&event) : SDL_PollEvent(&event)) {
+    while (NextEvent(&event, wait)) {
         wait = false;
         switch (event.type) {
             case SDL_EVENT_QUIT:
                 Log("Quitting");
-                SDL_Quit();
                 return false;
 
             case SDL_EVENT_JOYSTICK_ADDED:
-                {
-                    SharedLockGuard _{ engine_mutex, LockState::Unique };
-                    auto joystick = SDL_OpenJoystick(event.jdevice.which);
-                    if (!joystick) {
-                        Log("WARN: Joystick added but could not open");
-                        break;
-                    }
-                    auto name = SDL_GetJoystickName(joystick);
-                    if (!name) {
-                        Log("WARN: Joystick opened but could not get name");
-                        break;
-                    }
-                    Log("Joystick added: {}", name);
-                    joysticks.insert(joystick);
-                    joystick_event = true;
-                }
+                QueueJoystickOpen(event.jdevice.which);
                 break;
 
             case SDL_EVENT_JOYSTICK_REMOVED:
                 {
-                    SharedLockGuard _{ engine_mutex, LockState::Unique };
                     auto joystick = SDL_GetJoystickFromID(event.jdevice.which);
                     if (!joystick) {
-                        Log("WARN: Joystick removed but had no valid object");
+                        // Still opening or failed to open, the opened event sees it disconnected
                         break;
                     }
+
+                    // May also be opened but not yet published, erasing it below is then a no-op
                     Log("Joystick removed: {}", SDL_GetJoystickName(joystick));
+
+                    // Left open, scripts may still hold handles to it
+                    SharedLockGuard _{ engine_mutex, LockState::Unique };
                     joysticks.erase(joystick);
+                    noise_gates.RemoveJoystick(event.jdevice.which);
                     joystick_event = true;
+                    joysticks_changed = true;
                 }
                 break;
 
+            case SDL_EVENT_JOYSTICK_BUTTON_DOWN:
+            case SDL_EVENT_JOYSTICK_BUTTON_UP:
+                button_changes.push_back({ event.jbutton.which, event.jbutton.button, event.jbutton.down });
+                joystick_event = true;
+                break;
+
             case SDL_EVENT_JOYSTICK_AXIS_MOTION:
+                // Plots show the raw device signal, including motion the gate rejects
+                CapturePlotAxisEvent(event.jaxis);
+                if (auto value = noise_gates.Filter(event.jaxis.which, event.jaxis.axis, event.jaxis.value)) {
+                    axis_samples.push_back({ event.jaxis.which, event.jaxis.axis, FromSNorm(*value), event.jaxis.timestamp });
+                    joystick_event = true;
+                }
+                break;
+
             case SDL_EVENT_JOYSTICK_BALL_MOTION:
             case SDL_EVENT_JOYSTICK_HAT_MOTION:
-            case SDL_EVENT_JOYSTICK_BUTTON_DOWN:
-            case SDL_EVENT_JOYSTICK_BUTTON_UP:
-            case SDL_EVENT_JOYSTICK_UPDATE_COMPLETE:
                 joystick_event = true;
                 break;
+
+            // Follows every device report, including ones made up entirely of gated axis jitter.
+            // Each meaningful change already arrives as its own event, so this never wakes scripts.
+            case SDL_EVENT_JOYSTICK_UPDATE_COMPLETE:
+                break;
             default:
                 if (event.type == joystick_update_event) {
                     joystick_event = true;
+                } else if (event.type == joystick_opened_event) {
+                    auto joystick = SDL_GetJoystickFromID(event.jdevice.which);
+                    if (!joystick) break;
+                    if (!SDL_JoystickConnected(joystick)) {
+                        // Unplugged before it could be published, nothing else holds this handle
+                        SDL_CloseJoystick(joystick);
+                        break;
+                    }
+
+                    Log("Joystick added: {}", SDL_GetJoystickName(joystick));
+                    SharedLockGuard _{ engine_mutex, LockState::Unique };
+                    joysticks.insert(joystick);
+                    joystick_event = true;
+                    joysticks_changed = true;
                 }
         }
     }
 
+    auto now = std::chrono::steady_clock::now();
+    if (logic_deadline && now >= *logic_deadline) {
+        joystick_event = true;
+    }
+    if (filter_deadline && now >= *filter_deadline) {
+        filter_step = true;
+    }
+
+    if (joysticks_changed) {
+        SharedLockGuard _{ engine_mutex, LockState::Unique };
+        UpdateScriptActivation();
+    }
+
+    if (ExecuteQueuedCommands()) {
+        joystick_event = true;
+    }
+
+    // Runs after commands, so that a reload picks its devices back out of the pool first
+    vjoystick_pool_deadline = TrimVirtualJoystickPool(now);
+
     return true;
 }
 
 // -----------------------------------------------------------------------------
 
+static
+void PresentVirtualDevices()
+{
+    auto now = std::chrono::steady_clock::now();
+    output_deadline = std::nullopt;
+
+    auto schedule = [](std::chrono::steady_clock::time_point deadline) {
+        if (!output_deadline || deadline < *output_deadline) output_deadline = deadline;
+    };
+
+    for (auto& script : scripts) {
+        // Outputs of dormant scripts were reset when they went dormant
+        if (script->dormant) continue;
+        for (auto* vjoy : script->vjoysticks) {
+            MAPPER_TRACE_SPAN("Virtual Joystick Output", vjoy->trace_label);
+            if (vjoy->Present(now)) schedule(vjoy->next_report);
+        }
+        for (auto* mouse : script->vmice) {
+            MAPPER_TRACE_SPAN("Virtual Mouse Output", mouse->trace_label);
+            if (mouse->Present(now)) schedule(mouse->next_tick);
+        }
+        for (auto* keyboard : script->vkeyboards) {
+            MAPPER_TRACE_SPAN("Virtual Keyboard Output", keyboard->trace_label);
+            keyboard->Present();
+        }
+    }
+}
+
 void UpdateJoysticks()
 {
-    if (!joystick_event) return;
+    if (!joystick_event && !filter_step) {
+        if (output_deadline && std::chrono::steady_clock::now() >= *output_deadline) {
+            SharedLockGuard _{ engine_mutex, LockState::Shared };
+            PresentVirtualDevices();
+            WriteTelemetry();
+        }
+        return;
+    }
+
+    MAPPER_TRACE_SPAN("Update Joysticks");
 
     SharedLockGuard lock{ engine_mutex, LockState::Shared };
 
+    for (auto& script : scripts) {
+        for (auto* device : script->input_devices) {
+            device->Snapshot();
+        }
+    }
+
+    // Filters and logic primitives are fed every sample and edge before any callbacks read them
+    auto now = std::chrono::steady_clock::now();
+    auto now_ns = SDL_GetTicksNS();
+    if (joystick_event) logic_deadline = std::nullopt;
+    filter_deadline = std::nullopt;
+    for (auto& script : scripts) {
+        if (script->dormant) continue;
+        MAPPER_TRACE_SPAN("Filters and Logic", script->trace_label);
+        if (script->channels.Ingest(axis_samples, now_ns)) {
+            // Keep stepping slewed or smoothed outputs natively until they settle
+            filter_deadline = now + std::chrono::milliseconds(1);
+        }
+        if (!joystick_event) continue;
+        auto deadline = script->logic.Evaluate(button_changes, now);
+        if (deadline && (!logic_deadline || *deadline < *logic_deadline)) logic_deadline = deadline;
+    }
+    button_changes.clear();
+    axis_samples.clear();
+
     auto start = std::chrono::high_resolution_clock::now();
     for (auto& script : scripts) {
+        if (script->dormant) continue;
+        if (!joystick_event && !script->channels.changed) continue;
         for (auto& callback : script->callbacks) {
             bool to_disable = false;
             std::optional<std::string> error;
             {
+                MAPPER_TRACE_SPAN("Callback", script->trace_label);
                 auto res = callback.call();
                 if (!res.valid()) {
                     ReportScriptError(script, res);
@@ -104,6 +340,7 @@ void UpdateJoysticks()
                 break;
             }
         }
+        script->logic.EndFrame();
     }
     FlushScriptDeleteQueue(lock);
     auto end = std::chrono::high_resolution_clock::now();
@@ -115,13 +352,9 @@ void UpdateJoysticks()
     auto util = average_script_dur / diff;
     average_script_util = average_script_util * 0.95 + util * 0.05;
 
-    for (auto& script : scripts) {
-        for (auto* vjoy : script->vjoysticks) {
-            vjoy->Update();
-        }
-    }
-
-    PushGUIRedrawEvent();
+    PresentVirtualDevices();
+    WriteTelemetry();
+    CapturePlotSamples();
 }
 
 void PushJoystickUpdateEvent()
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// -----------------------------------------------------------------------------
+//          External Inputs
+// -----------------------------------------------------------------------------
+
+// Public protocol for local producer processes (head trackers, telemetry
+// bridges, custom controllers) enabled with --external-inputs. Each producer
+// connects to the external input socket and sends a single ExternalDeviceHello.
+// Mapper then registers an SDL virtual joystick for it, so that scripts see it
+// through FindJoystick(vendor_id, product_id) like any physical device. The
+// device is removed when the connection closes.
+//
+// Stream transport: after the hello, the producer writes ExternalInputEvent
+// records to the socket.
+//
+// Ring transport: the hello carries two file descriptors (SCM_RIGHTS), a memfd
+// sized for ExternalInputRing and an eventfd. The producer writes events into
+// the ring in place and then signals the eventfd, Mapper consumes them straight
+// from the shared mapping:
+//
+//   producer: events[tail % capacity] = event, store tail (release), write eventfd
+//   consumer: load tail (acquire), read events [head, tail), store head (release)
+//
+// The producer must not advance tail more than `capacity` past head. All
+// fields are little endian. Any layout change bumps the version.
+
+constexpr uint32_t external_input_magic = 0x4E49584D; // "MXIN"
+constexpr uint32_t external_input_version = 1;
+
+constexpr uint32_t external_max_axes = 16;
+constexpr uint32_t external_max_buttons = 128;
+constexpr uint32_t external_ring_capacity = 1024;
+
+enum class ExternalTransport : uint32_t
+{
+    Stream,
+    Ring,
+};
+
+struct ExternalDeviceHello
+{
+    uint32_t magic;
+    uint32_t version;
+    char name[64];
+    uint16_t vendor_id;
+    uint16_t product_id;
+    uint16_t num_axes;
+    uint16_t num_buttons;
+    ExternalTransport transport;
+};
+
+enum class ExternalEventType : uint16_t
+{
+    Axis = 1,
+    Button = 2,
+};
+
+struct ExternalInputEvent
+{
+    ExternalEventType type;
+    uint16_t index;
+
+    // Axes are -1 to 1, buttons are pressed when non-zero
+    float value;
+};
+
+struct ExternalInputRing
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t capacity;
+    uint32_t reserved;
+
+    // Consumer position, only written by Mapper
+    alignas(64) std::atomic<uint64_t> head;
+
+    // Producer position, only written by the producer
+    alignas(64) std::atomic<uint64_t> tail;
+
+    alignas(64) ExternalInputEvent events[external_ring_capacity];
+};
+
+static_assert(sizeof(ExternalInputEvent) == 8);
+static_assert(sizeof(ExternalDeviceHello) == 84);
+static_assert(offsetof(ExternalInputRing, head) == 64);
+static_assert(offsetof(ExternalInputRing, tail) == 128);
+static_assert(offsetof(ExternalInputRing, events) == 192);
+
+void StartExternalInputServer();
+void StopExternalInputServer();
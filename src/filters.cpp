@@ -0,0 +1,255 @@
+#include "mapper.hpp"
+
+#include <numbers>
+
+// -----------------------------------------------------------------------------
+//          Filters
+// -----------------------------------------------------------------------------
+
+static
+float SmoothingFactor(float dt, float cutoff)
+{
+    auto tau = 1.f / (2.f * std::numbers::pi_v<float> * cutoff);
+    return 1.f / (1.f + tau / dt);
+}
+
+static
+void Step(AxisFilter& filter, float x, float dt)
+{
+    // Samples stamped at or before the last step only update the target
+    if (dt <= 0.f) return;
+
+    switch (filter.type) {
+        case FilterType::OneEuro:
+            {
+                auto dx = (x - filter.input) / dt;
+                filter.derivative += SmoothingFactor(dt, filter.d_cutoff) * (dx - filter.derivative);
+                auto cutoff = filter.min_cutoff + filter.beta * std::abs(filter.derivative);
+                filter.value += SmoothingFactor(dt, cutoff) * (x - filter.value);
+            }
+            break;
+        case FilterType::EMA:
+            filter.value += (1.f - std::exp(-dt / std::max(filter.time_constant, 1e-6f))) * (x - filter.value);
+            break;
+        case FilterType::Slew:
+            {
+                auto max_delta = filter.rate * dt;
+                filter.value += std::clamp(x - filter.value, -max_delta, max_delta);
+            }
+            break;
+        case FilterType::Median:
+            break;
+    }
+}
+
+void AxisFilter::Push(float x, uint64_t time_ns)
+{
+    if (type == FilterType::Median) {
+        history[history_next] = x;
+        history_next = (history_next + 1) % window;
+        history_count = std::min(history_count + 1, window);
+
+        std::array<float, max_median_window> sorted;
+        std::copy_n(history.begin(), history_count, sorted.begin());
+        std::nth_element(sorted.begin(), sorted.begin() + history_count / 2, sorted.begin() + history_count);
+        value = sorted[history_count / 2];
+        return;
+    }
+
+    if (!initialized) {
+        initialized = true;
+        value = x;
+        published = x;
+    } else {
+        // A timer step may have already advanced past this sample's timestamp, apply it with no time elapsed
+        Step(*this, x, time_ns > last_ns ? float(time_ns - last_ns) * 1e-9f : 0.f);
+    }
+
+    input = x;
+    last_ns = std::max(last_ns, time_ns);
+}
+
+bool AxisFilter::Advance(uint64_t now_ns)
+{
+    if (type == FilterType::Median || !initialized) return false;
+    if (std::abs(value - input) < filter_settle_tolerance) {
+        value = input;
+        return false;
+    }
+
+    if (now_ns > last_ns) {
+        Step(*this, input, float(now_ns - last_ns) * 1e-9f);
+        last_ns = now_ns;
+    }
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+//          Channels
+// -----------------------------------------------------------------------------
+
+static
+uint64_t ChannelKey(uint32_t joystick, uint8_t axis)
+{
+    return (uint64_t(joystick) << 8) | axis;
+}
+
+AxisChannel* ChannelSet::Get(uint32_t joystick, uint8_t axis, float initial)
+{
+    auto& channel = channels[ChannelKey(joystick, axis)];
+    if (!channel) {
+        channel = new AxisChannel{ .joystick = joystick, .axis = axis, .value = initial };
+    }
+    return channel;
+}
+
+AxisFilter* ChannelSet::AddFilter(AxisChannel* channel, AxisFilter desc)
+{
+    auto filter = new AxisFilter(desc);
+    filter->window = std::clamp<uint32_t>(filter->window, 1, max_median_window);
+    filter->Push(channel->value, SDL_GetTicksNS());
+    channel->filters.emplace_back(filter);
+    return filter;
+}
+
+void ChannelSet::Clear()
+{
+    for (auto& [_, channel] : channels) {
+        for (auto* filter : channel->filters) {
+            delete filter;
+        }
+        delete channel;
+    }
+    channels.clear();
+}
+
+bool ChannelSet::Ingest(std::span<const AxisSample> samples, uint64_t now_ns)
+{
+    changed = false;
+    if (channels.empty()) return false;
+
+    for (auto& [_, channel] : channels) {
+        channel->batch.clear();
+    }
+
+    for (auto& sample : samples) {
+        auto found = channels.find(ChannelKey(sample.joystick, sample.axis));
+        if (found == channels.end()) continue;
+
+        auto* channel = found->second;
+        channel->value = sample.value;
+        channel->batch.push_back(sample);
+        for (auto* filter : channel->filters) {
+            filter->Push(sample.value, sample.time_ns);
+        }
+    }
+
+    bool converging = false;
+    for (auto& [_, channel] : channels) {
+        for (auto* filter : channel->filters) {
+            converging |= filter->Advance(now_ns);
+            if (std::abs(filter->value - filter->published) >= filter_settle_tolerance) {
+                filter->published = filter->value;
+                changed = true;
+            }
+        }
+    }
+
+    return converging;
+}
+
+// -----------------------------------------------------------------------------
+//          Noise Gates
+// -----------------------------------------------------------------------------
+
+static
+uint64_t GateKey(uint32_t joystick, uint16_t axis)
+{
+    return (uint64_t(joystick) << 16) | axis;
+}
+
+static
+int16_t Calibrate(const AxisGate& gate, int16_t raw)
+{
+    return int16_t(std::clamp<int32_t>(raw + gate.offset, -32768, 32767));
+}
+
+static
+const AxisGate* FindGate(NoiseGates& gates, uint32_t joystick, uint8_t axis)
+{
+    if (auto found = gates.gates.find(GateKey(joystick, axis)); found != gates.gates.end()) return &found->second;
+    if (auto found = gates.gates.find(GateKey(joystick, NoiseGates::any_axis)); found != gates.gates.end()) return &found->second;
+    return nullptr;
+}
+
+void NoiseGates::Set(uint32_t joystick, uint16_t axis, AxisGate gate)
+{
+    // Device wide gates overlap every axis gate on the same joystick
+    for (auto& [key, existing] : gates) {
+        if (existing.owner == gate.owner || uint32_t(key >> 16) != joystick) continue;
+        auto existing_axis = uint16_t(key);
+        if (axis == any_axis || existing_axis == any_axis || existing_axis == axis) {
+            Error("Noise gate for joystick {} axis {} conflicts with a gate set by another script", joystick,
+                axis == any_axis ? std::string("(all)") : std::to_string(axis));
+        }
+    }
+
+    gates[GateKey(joystick, axis)] = gate;
+
+    // Restart gating from the next event with the new calibration
+    for (auto& [key, state] : axes) {
+        if ((key >> 16) == joystick && (axis == any_axis || (key & 0xFFFF) == axis)) state.reported = std::nullopt;
+    }
+}
+
+void NoiseGates::RemoveOwner(const void* owner)
+{
+    if (std::erase_if(gates, [&](auto& entry) { return entry.second.owner == owner; })) {
+        std::erase_if(axes, [&](auto& entry) { return !FindGate(*this, uint32_t(entry.first >> 16), uint8_t(entry.first)); });
+    }
+}
+
+void NoiseGates::RemoveJoystick(uint32_t joystick)
+{
+    std::erase_if(gates, [&](auto& entry) { return (entry.first >> 16) == joystick; });
+    std::erase_if(axes, [&](auto& entry) { return (entry.first >> 16) == joystick; });
+}
+
+std::optional<int16_t> NoiseGates::Filter(uint32_t joystick, uint8_t axis, int16_t raw)
+{
+    ++raw_events;
+
+    if (gates.empty()) return raw;
+    auto gate = FindGate(*this, joystick, axis);
+    if (!gate) return raw;
+
+    auto& state = axes[GateKey(joystick, axis)];
+    ++state.raw_events;
+
+    auto value = Calibrate(*gate, raw);
+    if (!state.reported) {
+        state.reported = value;
+        return value;
+    }
+
+    bool full_scale = value == 32767 || value == -32768;
+    if (std::abs(int32_t(value) - int32_t(*state.reported)) <= gate->threshold && !(full_scale && value != *state.reported)) {
+        ++gated_events;
+        ++state.gated_events;
+        return std::nullopt;
+    }
+
+    state.reported = value;
+    return value;
+}
+
+int16_t NoiseGates::Read(uint32_t joystick, uint8_t axis, int16_t raw)
+{
+    if (gates.empty()) return raw;
+    auto gate = FindGate(*this, joystick, axis);
+    if (!gate) return raw;
+
+    if (auto state = axes.find(GateKey(joystick, axis)); state != axes.end() && state->second.reported) return *state->second.reported;
+    return Calibrate(*gate, raw);
+}
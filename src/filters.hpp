@@ -0,0 +1,161 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+//          Axis Samples
+// -----------------------------------------------------------------------------
+
+// Every axis event in a wakeup is kept with its device timestamp, so that
+// filters see each sample at device rate with correct time deltas no matter
+// how often script callbacks run.
+
+struct AxisSample
+{
+    uint32_t joystick;
+    uint8_t axis;
+    float value;
+    uint64_t time_ns;
+};
+
+// -----------------------------------------------------------------------------
+//          Noise Gates
+// -----------------------------------------------------------------------------
+
+// Applied to raw axis events as they are ingested, before anything wakes the
+// scripts. A gated axis only reports once it moves more than `threshold` LSB
+// away from the last reported value, so jitter around a resting position is
+// dropped and small reversals need the full threshold to register. Full scale
+// values always pass so that the ends of travel stay reachable.
+
+struct AxisGate
+{
+    int32_t threshold = 0;
+
+    // Calibration, added to the raw value before gating
+    int32_t offset = 0;
+
+    // Gates are removed along with the script that configured them
+    const void* owner = nullptr;
+};
+
+// Per joystick axis gating state, kept while a gate covers the axis
+struct GatedAxis
+{
+    // Last calibrated value reported, gating restarts from the next event when empty
+    std::optional<int16_t> reported;
+
+    uint64_t raw_events = 0;
+    uint64_t gated_events = 0;
+};
+
+struct NoiseGates
+{
+    // Keyed by joystick and axis, device wide gates use `any_axis`
+    static constexpr uint16_t any_axis = 0x100;
+
+    std::unordered_map<uint64_t, AxisGate> gates;
+    std::unordered_map<uint64_t, GatedAxis> axes;
+
+    uint64_t raw_events = 0;
+    uint64_t gated_events = 0;
+
+    // Throws if another owner already gates any of the same axes
+    void Set(uint32_t joystick, uint16_t axis, AxisGate gate);
+    void RemoveOwner(const void* owner);
+    void RemoveJoystick(uint32_t joystick);
+
+    // Returns the calibrated value to report, or nothing if the change is within the gate
+    std::optional<int16_t> Filter(uint32_t joystick, uint8_t axis, int16_t raw);
+
+    // Current calibrated and gated value of an axis
+    int16_t Read(uint32_t joystick, uint8_t axis, int16_t raw);
+};
+
+// -----------------------------------------------------------------------------
+//          Filters
+// -----------------------------------------------------------------------------
+
+enum class FilterType : uint8_t
+{
+    // Adaptive low pass, smooth when still and responsive when moving
+    OneEuro,
+
+    // Exponential moving average with a time constant
+    EMA,
+
+    // Limits the rate of change in units per second
+    Slew,
+
+    // Median of the last `window` samples, removes single sample spikes
+    Median,
+};
+
+constexpr uint32_t max_median_window = 9;
+
+// One LSB of a 16 bit axis, smaller changes are invisible on any output device
+constexpr float filter_settle_tolerance = 1.f / 32767.f;
+
+struct AxisFilter
+{
+    FilterType type;
+
+    float min_cutoff = 1.f;
+    float beta = 0.f;
+    float d_cutoff = 1.f;
+    float time_constant = 0.05f;
+    float rate = 10.f;
+    uint32_t window = 3;
+
+    bool initialized = false;
+    float input = 0.f;
+    float value = 0.f;
+    float derivative = 0.f;
+    uint64_t last_ns = 0;
+
+    // Value as of the last time the owning script was woken for it
+    float published = 0.f;
+
+    std::array<float, max_median_window> history = {};
+    uint32_t history_count = 0;
+    uint32_t history_next = 0;
+
+    void Push(float x, uint64_t time_ns);
+
+    // Steps time based filters towards the last input, returns true if still converging
+    bool Advance(uint64_t now_ns);
+};
+
+struct AxisChannel
+{
+    uint32_t joystick;
+    uint8_t axis;
+
+    float value = 0.f;
+
+    // Raw samples received since the last update
+    std::vector<AxisSample> batch;
+
+    std::vector<AxisFilter*> filters;
+};
+
+struct ChannelSet
+{
+    std::unordered_map<uint64_t, AxisChannel*> channels;
+
+    // Set by Ingest when a filtered value moved by at least filter_settle_tolerance
+    bool changed = false;
+
+    AxisChannel* Get(uint32_t joystick, uint8_t axis, float initial);
+    AxisFilter* AddFilter(AxisChannel* channel, AxisFilter filter);
+    void Clear();
+
+    // Feeds this update's samples through all filters, returns true if any filter needs to run again soon
+    bool Ingest(std::span<const AxisSample> samples, uint64_t now_ns);
+};
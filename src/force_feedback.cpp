@@ -0,0 +1,42 @@
+#include "mapper.hpp"
+
+void SetForceFeedbackRoute(VirtualJoystick* vjoy, const ForceFeedbackRoute& route)
+{
+    std::scoped_lock _{ vjoy->ff_mutex };
+    vjoy->ff_route = route;
+}
+
+// Called from the backend's force feedback thread, must never wait on engine_mutex
+void DispatchForceFeedback(VirtualJoystick* vjoy, float low, float high, uint32_t duration_ms, std::chrono::steady_clock::time_point issued)
+{
+    ForceFeedbackRoute route;
+    {
+        std::scoped_lock _{ vjoy->ff_mutex };
+        route = vjoy->ff_route;
+    }
+
+    auto& stats = vjoy->ff_stats;
+
+    if (route.drop) {
+        ++stats.dropped;
+        return;
+    }
+
+    low  = std::clamp(low  * route.scale, 0.f, 1.f);
+    high = std::clamp(high * route.scale, 0.f, 1.f);
+    if (route.swap_motors) std::swap(low, high);
+
+    if (route.target) {
+        auto joystick = SDL_GetJoystickFromID(route.target);
+        if (!joystick || !SDL_RumbleJoystick(joystick, Uint16(low * 0xFFFF), Uint16(high * 0xFFFF), duration_ms)) {
+            ++stats.dropped;
+            return;
+        }
+    }
+
+    ++stats.plays;
+
+    auto round_trip = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - issued).count();
+    auto average = stats.average_round_trip_ns.load(std::memory_order_relaxed);
+    stats.average_round_trip_ns.store(average ? (average * 15 + round_trip) / 16 : round_trip, std::memory_order_relaxed);
+}
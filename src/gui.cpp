@@ -1,4 +1,5 @@
 #include "mapper.hpp"
+#include "gui.hpp"
 
 #include <GLFW/glfw3.h>
 
@@ -21,7 +22,18 @@
 
 #include <thread>
 
-#define ImGui_Print(...) ImGui::Text("%s", std::format(__VA_ARGS__).c_str())
+// Formats into a reused buffer, the result is only valid until the next call
+template<typename... Args>
+static
+const char* ImGui_Format(std::format_string<Args...> fmt, Args&&... args)
+{
+    static char buffer[1024];
+    auto res = std::format_to_n(buffer, sizeof(buffer) - 1, fmt, std::forward<Args>(args)...);
+    *res.out = '\0';
+    return buffer;
+}
+
+#define ImGui_Print(...) ImGui::TextUnformatted(ImGui_Format(__VA_ARGS__))
 
 constexpr auto ImGui_ToggleButtonSpacing = 4.f;
 constexpr auto ImGui_TopWindowPaddingAdjustment = -3.f;
@@ -58,89 +70,176 @@ struct ImGui_IDGuard
     }
 };
 
+// The GUI only ever reads the published engine state snapshot and talks to the
+// engine through commands, so it can run either in-process or as a separate
+// client attached to a daemon.
+
+struct GUIConnection
+{
+    StateRegion* region = nullptr;
+
+    // Only set for remote clients, otherwise commands are queued in-process
+    CommandConnection* commands = nullptr;
+
+    void Send(Command command)
+    {
+        if (commands) SendCommand(commands, command);
+        else QueueCommand(std::move(command));
+    }
+};
+
+static GUIConnection connection;
+static EngineState state;
+static LockStatsState lock_stats;
+
 GLFWwindow* window;
 std::jthread gui_thread;
 std::atomic<uint64_t> pending_gui_update_id = 1;
 
-void PushGUIRedrawEvent()
-{
-    ++pending_gui_update_id;
-    glfwPostEmptyEvent();
-}
-
 void DrawGUI();
+static void SyncPlotSelection();
+static bool DrainPlotSamples();
 
-void OpenGUI()
+static
+void RunGUI(bool remote)
 {
-    gui_thread = std::jthread([] {
-        glfwInit();
+    // Only one GUI may write the plot selection and consume the plot rings
+    auto reader_token = ClaimStateReader(connection.region);
+    if (!reader_token) {
+        Error("Another GUI is already attached");
+    }
+    Defer _ = [&] { ReleaseStateReader(connection.region, reader_token); };
+
+    glfwInit();
 
-        glfwWindowHintString(GLFW_WAYLAND_APP_ID, "Mapper");
+    glfwWindowHintString(GLFW_WAYLAND_APP_ID, "Mapper");
 
-        window = glfwCreateWindow(960, 720, "Mapper", nullptr, nullptr);
+    window = glfwCreateWindow(960, 720, "Mapper", nullptr, nullptr);
 
 #if defined(WIN32)
-        {
-            auto hwnd = glfwGetWin32Window(window);
-            BOOL value = true;
-            ::DwmSetWindowAttribute(hwnd, 20 /* DWMWA_USE_IMMERSIVE_DARK_MODE */, &value, sizeof(value));
-        }
+    {
+        auto hwnd = glfwGetWin32Window(window);
+        BOOL value = true;
+        ::DwmSetWindowAttribute(hwnd, 20 /* DWMWA_USE_IMMERSIVE_DARK_MODE */, &value, sizeof(value));
+    }
 #endif
 
-        glfwMakeContextCurrent(window);
-        glfwSwapInterval(1);
-
-        ImGui::CreateContext();
-        ImGui::GetIO().ConfigFlags |= ImGuiConfigFlags_DockingEnable;
-
-        ImGui_ImplGlfw_InitForOpenGL(window, false);
-        ImGui_ImplOpenGL3_Init();
-
-        // Only redraw GUI on specific events to filter out Wayland refresh events
-
-        #define MAPPER_REGISTER_GLFW_CALLBACK_PASSTHROUGH_IMGUI(name, ...) glfwSet##name(__VA_ARGS__ __VA_OPT__(,) [](auto... args) { \
-            ++pending_gui_update_id; \
-            ImGui_ImplGlfw_##name(args...); \
-        })
-
-        #define MAPPER_REGISTER_GLFW_CALLBACK_EMPTY(name, ...) glfwSet##name(__VA_ARGS__ __VA_OPT__(,) [](auto...) { \
-            ++pending_gui_update_id; \
-        })
-
-        MAPPER_REGISTER_GLFW_CALLBACK_PASSTHROUGH_IMGUI(WindowFocusCallback, window);
-        MAPPER_REGISTER_GLFW_CALLBACK_PASSTHROUGH_IMGUI(CursorEnterCallback, window);
-        MAPPER_REGISTER_GLFW_CALLBACK_PASSTHROUGH_IMGUI(CursorPosCallback, window);
-        MAPPER_REGISTER_GLFW_CALLBACK_PASSTHROUGH_IMGUI(MouseButtonCallback, window);
-        MAPPER_REGISTER_GLFW_CALLBACK_PASSTHROUGH_IMGUI(ScrollCallback, window);
-        MAPPER_REGISTER_GLFW_CALLBACK_PASSTHROUGH_IMGUI(KeyCallback, window);
-        MAPPER_REGISTER_GLFW_CALLBACK_PASSTHROUGH_IMGUI(CharCallback, window);
-        MAPPER_REGISTER_GLFW_CALLBACK_PASSTHROUGH_IMGUI(MonitorCallback);
-
-        MAPPER_REGISTER_GLFW_CALLBACK_EMPTY(WindowPosCallback, window);
-        MAPPER_REGISTER_GLFW_CALLBACK_EMPTY(WindowSizeCallback, window);
-        MAPPER_REGISTER_GLFW_CALLBACK_EMPTY(WindowCloseCallback, window);
-        MAPPER_REGISTER_GLFW_CALLBACK_EMPTY(WindowRefreshCallback, window);
-        MAPPER_REGISTER_GLFW_CALLBACK_EMPTY(WindowIconifyCallback, window);
-        MAPPER_REGISTER_GLFW_CALLBACK_EMPTY(WindowMaximizeCallback, window);
-        MAPPER_REGISTER_GLFW_CALLBACK_EMPTY(FramebufferSizeCallback, window);
-        MAPPER_REGISTER_GLFW_CALLBACK_EMPTY(WindowContentScaleCallback, window);
-        MAPPER_REGISTER_GLFW_CALLBACK_EMPTY(CharModsCallback, window);
-        MAPPER_REGISTER_GLFW_CALLBACK_EMPTY(DropCallback, window);
-        MAPPER_REGISTER_GLFW_CALLBACK_EMPTY(JoystickCallback);
-
-        uint64_t gui_update_id = 0;
-
-        while (!glfwWindowShouldClose(window)) {
+    glfwMakeContextCurrent(window);
+    glfwSwapInterval(1);
+
+    ImGui::CreateContext();
+    ImGui::GetIO().ConfigFlags |= ImGuiConfigFlags_DockingEnable;
+
+    ImGui_ImplGlfw_InitForOpenGL(window, false);
+    ImGui_ImplOpenGL3_Init();
+
+    // Only redraw GUI on specific events to filter out Wayland refresh events
+
+    #define MAPPER_REGISTER_GLFW_CALLBACK_PASSTHROUGH_IMGUI(name, ...) glfwSet##name(__VA_ARGS__ __VA_OPT__(,) [](auto... args) { \
+        ++pending_gui_update_id; \
+        ImGui_ImplGlfw_##name(args...); \
+    })
+
+    #define MAPPER_REGISTER_GLFW_CALLBACK_EMPTY(name, ...) glfwSet##name(__VA_ARGS__ __VA_OPT__(,) [](auto...) { \
+        ++pending_gui_update_id; \
+    })
+
+    MAPPER_REGISTER_GLFW_CALLBACK_PASSTHROUGH_IMGUI(WindowFocusCallback, window);
+    MAPPER_REGISTER_GLFW_CALLBACK_PASSTHROUGH_IMGUI(CursorEnterCallback, window);
+    MAPPER_REGISTER_GLFW_CALLBACK_PASSTHROUGH_IMGUI(CursorPosCallback, window);
+    MAPPER_REGISTER_GLFW_CALLBACK_PASSTHROUGH_IMGUI(MouseButtonCallback, window);
+    MAPPER_REGISTER_GLFW_CALLBACK_PASSTHROUGH_IMGUI(ScrollCallback, window);
+    MAPPER_REGISTER_GLFW_CALLBACK_PASSTHROUGH_IMGUI(KeyCallback, window);
+    MAPPER_REGISTER_GLFW_CALLBACK_PASSTHROUGH_IMGUI(CharCallback, window);
+    MAPPER_REGISTER_GLFW_CALLBACK_PASSTHROUGH_IMGUI(MonitorCallback);
+
+    MAPPER_REGISTER_GLFW_CALLBACK_EMPTY(WindowPosCallback, window);
+    MAPPER_REGISTER_GLFW_CALLBACK_EMPTY(WindowSizeCallback, window);
+    MAPPER_REGISTER_GLFW_CALLBACK_EMPTY(WindowCloseCallback, window);
+    MAPPER_REGISTER_GLFW_CALLBACK_EMPTY(WindowRefreshCallback, window);
+    MAPPER_REGISTER_GLFW_CALLBACK_EMPTY(WindowIconifyCallback, window);
+    MAPPER_REGISTER_GLFW_CALLBACK_EMPTY(WindowMaximizeCallback, window);
+    MAPPER_REGISTER_GLFW_CALLBACK_EMPTY(FramebufferSizeCallback, window);
+    MAPPER_REGISTER_GLFW_CALLBACK_EMPTY(WindowContentScaleCallback, window);
+    MAPPER_REGISTER_GLFW_CALLBACK_EMPTY(CharModsCallback, window);
+    MAPPER_REGISTER_GLFW_CALLBACK_EMPTY(DropCallback, window);
+    MAPPER_REGISTER_GLFW_CALLBACK_EMPTY(JoystickCallback);
+
+    // The engine only publishes while a reader heartbeat is fresh, ask for an initial snapshot
+    connection.Send({ .type = CommandType::Refresh });
+
+    // Redraws are capped to the configured rate, and the engine publishes no faster than that either
+    auto frame_interval = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+        std::chrono::duration<double>(1.0 / std::max(gui_max_fps, 1.0)));
+    connection.region->reader_interval_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(frame_interval).count();
+
+    uint64_t gui_update_id = 0;
+    uint64_t state_sequence = 0;
+    uint64_t lock_stats_sequence = 0;
+    auto next_frame = std::chrono::steady_clock::now();
+
+    while (!glfwWindowShouldClose(window)) {
+        // A reader that stalled past the timeout may have been replaced by another GUI
+        if (connection.region->reader_owner.load(std::memory_order_acquire) != reader_token) {
+            LogWarn("Another GUI took over the engine state, detaching");
+            break;
+        }
+        connection.region->reader_heartbeat_ns.store(StateClockNow(), std::memory_order_relaxed);
+
+        auto now = std::chrono::steady_clock::now();
+        if (now >= next_frame) {
+            next_frame = now + frame_interval;
+
+            SyncPlotSelection();
+            bool redraw = DrainPlotSamples();
+
+            auto sequence = connection.region->state.sequence.load(std::memory_order_acquire);
+            if (sequence != state_sequence && !(sequence & 1)) {
+                if (auto read = connection.region->state.TryRead(state)) {
+                    state_sequence = read;
+                    redraw = true;
+                }
+            }
+
+            // Only ever written by engines built with MAPPER_LOCK_STATS
+            sequence = connection.region->lock_stats.sequence.load(std::memory_order_acquire);
+            if (sequence != lock_stats_sequence && !(sequence & 1)) {
+                if (auto read = connection.region->lock_stats.TryRead(lock_stats)) {
+                    lock_stats_sequence = read;
+                    redraw = true;
+                }
+            }
+
             auto next_gui_update_id = pending_gui_update_id.load();
             if (next_gui_update_id > gui_update_id) {
                 gui_update_id = next_gui_update_id;
+                redraw = true;
+            }
+
+            if (redraw) {
+                MAPPER_TRACE_SPAN("GUI Frame");
                 DrawGUI();
             }
+        }
 
-            glfwWaitEvents();
+        // Remote clients own their SDL event loop, required for file dialogs
+        if (remote) {
+            SDL_PumpEvents();
         }
 
-        glfwTerminate();
+        auto remaining = std::chrono::duration<double>(next_frame - std::chrono::steady_clock::now());
+        glfwWaitEventsTimeout(std::max(remaining.count(), 0.0));
+    }
+
+    glfwTerminate();
+}
+
+void OpenGUI()
+{
+    connection = { .region = state_region };
+    gui_thread = std::jthread([] {
+        MAPPER_TRACE_THREAD("GUI");
+        RunGUI(false);
     });
 }
 
@@ -154,6 +253,21 @@ void CloseGUI()
     }
 }
 
+int RunGUIClient()
+{
+    SDL_InitSubSystem(SDL_INIT_EVENTS);
+
+    connection = {
+        .region = OpenStateRegion(),
+        .commands = ConnectCommandServer(),
+    };
+    Defer _ = [] { CloseCommandConnection(connection.commands); };
+
+    RunGUI(true);
+
+    return EXIT_SUCCESS;
+}
+
 // -----------------------------------------------------------------------------
 
 template<typename MenuFn>
@@ -224,12 +338,9 @@ void DrawFileMenu()
                 return;
             }
 
-            SharedLockGuard _{ engine_mutex, LockState::Unique };
-
             for (const char* file; (file = *filelist); ++filelist) {
-                Log("Loading script: {}", file);
                 auto path = std::filesystem::canonical(file);
-                LoadScript(file);
+                connection.Send({ .type = CommandType::LoadScript, .path = path.string() });
             }
         }, nullptr, nullptr, nullptr, 0, std::filesystem::current_path().string().c_str(), true);
     }
@@ -237,37 +348,310 @@ void DrawFileMenu()
     ImGui::EndMenu();
 }
 
+// -----------------------------------------------------------------------------
+//          Plots
+// -----------------------------------------------------------------------------
+
+struct PlotHistory
+{
+    uint64_t tail = 0;
+    uint64_t count = 0;
+    std::array<PlotSample, state_plot_capacity> samples;
+
+    const PlotSample& FromNewest(uint64_t i) const { return samples[(count - 1 - i) % state_plot_capacity]; }
+};
+
+// Channels chosen in the GUI, only published to the engine while the plot panel is visible
+static PlotSelection plot_selection = {};
+static PlotSelection published_plot_selection = {};
+static uint32_t plot_generation = 0;
+static std::array<PlotHistory, state_max_plot_channels> plot_histories;
+static bool plots_visible = false;
+static float plot_window_seconds = 5.f;
+static int plot_scatter_x = -1;
+static int plot_scatter_y = -1;
+
+static
+int FindPlotChannel(PlotSource source, uint64_t device, uint32_t index)
+{
+    for (uint32_t i = 0; i < state_max_plot_channels; ++i) {
+        auto& channel = plot_selection.channels[i];
+        if (channel.source == source && channel.device == device && channel.index == index) return int(i);
+    }
+    return -1;
+}
+
+static
+void TogglePlotChannel(PlotSource source, uint64_t device, uint32_t index)
+{
+    if (auto existing = FindPlotChannel(source, device, index); existing >= 0) {
+        plot_selection.channels[existing] = {};
+        return;
+    }
+
+    if (auto free = FindPlotChannel(PlotSource::None, 0, 0); free >= 0) {
+        plot_selection.channels[free] = { .source = source, .index = index, .device = device };
+    }
+}
+
+static
+void SyncPlotSelection()
+{
+    auto selection = plots_visible ? plot_selection : PlotSelection{};
+    if (std::memcmp(&selection, &published_plot_selection, sizeof(selection)) == 0) return;
+
+    published_plot_selection = selection;
+    connection.region->plot_selection.Write([&](PlotSelection& out) { out = selection; });
+    plot_generation = uint32_t(connection.region->plot_selection.sequence.load(std::memory_order_relaxed));
+
+    for (uint32_t i = 0; i < state_max_plot_channels; ++i) {
+        plot_histories[i].tail = connection.region->plot_rings[i].head.load(std::memory_order_acquire);
+        plot_histories[i].count = 0;
+    }
+}
+
+// Copies new samples out of the engine's rings, returns true if any channel is being plotted
+static
+bool DrainPlotSamples()
+{
+    bool any = false;
+
+    for (uint32_t i = 0; i < state_max_plot_channels; ++i) {
+        if (published_plot_selection.channels[i].source == PlotSource::None) continue;
+        any = true;
+
+        auto& ring = connection.region->plot_rings[i];
+        auto& history = plot_histories[i];
+
+        // Skip the oldest part of the ring if we fell behind, keeping a margin so
+        // that the engine can't lap the samples while they are being copied
+        constexpr uint64_t margin = state_plot_capacity / 8;
+        auto head = ring.head.load(std::memory_order_acquire);
+        if (head - history.tail > state_plot_capacity - margin) {
+            history.tail = head - (state_plot_capacity - margin);
+        }
+
+        for (; history.tail < head; ++history.tail) {
+            auto sample = ring.samples[history.tail % state_plot_capacity];
+            if (sample.generation != plot_generation) continue;
+            history.samples[history.count++ % state_plot_capacity] = sample;
+        }
+    }
+
+    return any;
+}
+
+static
+const char* PlotDeviceName(const PlotChannel& channel)
+{
+    if (channel.source == PlotSource::JoystickAxis) {
+        for (uint32_t i = 0; i < state.num_joysticks; ++i) {
+            if (state.joysticks[i].id == channel.device) return state.joysticks[i].name.c_str();
+        }
+    } else if (channel.source == PlotSource::VirtualJoystickAxis) {
+        for (uint32_t i = 0; i < state.num_vjoysticks; ++i) {
+            if (state.vjoysticks[i].id == channel.device) return state.vjoysticks[i].name.c_str();
+        }
+    }
+    return "?";
+}
+
+static
+void DrawPlotToggle(PlotSource source, uint64_t device, uint32_t index)
+{
+    ImGui_IDGuard _ = int(index);
+    bool plotted = FindPlotChannel(source, device, index) >= 0;
+    if (ImGui::Checkbox("##plot", &plotted)) {
+        TogglePlotChannel(source, device, index);
+    }
+    ImGui::SetItemTooltip("Plot");
+    ImGui::SameLine();
+}
+
+static
+ImVec2 BeginPlotCanvas(const char* id, float height, ImVec2& pos)
+{
+    ImVec2 size(ImGui::GetContentRegionAvail().x, height);
+    pos = ImGui::GetCursorScreenPos();
+    ImGui::InvisibleButton(id, ImVec2(std::max(size.x, 1.f), size.y));
+    auto draw = ImGui::GetWindowDrawList();
+    draw->AddRectFilled(pos, ImVec2(pos.x + size.x, pos.y + size.y), ImGui::GetColorU32(ImGuiCol_FrameBg));
+    return size;
+}
+
+static
+void DrawTimeSeries(uint32_t channel_index, int64_t now_ns)
+{
+    auto& history = plot_histories[channel_index];
+    auto window_ns = int64_t(plot_window_seconds * 1e9);
+
+    ImVec2 pos;
+    auto size = BeginPlotCanvas("##series", 80.f, pos);
+    auto draw = ImGui::GetWindowDrawList();
+    auto to_y = [&](float v) { return pos.y + size.y * (0.5f - 0.5f * std::clamp(v, -1.f, 1.f)); };
+    draw->AddLine(ImVec2(pos.x, to_y(0.f)), ImVec2(pos.x + size.x, to_y(0.f)), ImGui::GetColorU32(ImGuiCol_Border));
+
+    auto color = ImGui::GetColorU32(ImGuiCol_PlotLines);
+    auto count = std::min<uint64_t>(history.count, state_plot_capacity);
+    std::optional<ImVec2> last;
+    for (uint64_t i = 0; i < count; ++i) {
+        auto& sample = history.FromNewest(i);
+        auto age = now_ns - sample.time_ns;
+        if (age > window_ns) break;
+
+        ImVec2 point(pos.x + size.x * (1.f - float(age) / float(window_ns)), to_y(sample.value));
+        if (last) draw->AddLine(*last, point, color);
+        last = point;
+    }
+}
+
+// Input vs output. Channels are sampled at different times, each sample is paired
+// with the latest sample of the other channel at that time.
+static
+void DrawScatter(uint32_t x_index, uint32_t y_index, int64_t now_ns)
+{
+    auto& xs = plot_histories[x_index];
+    auto& ys = plot_histories[y_index];
+    auto window_ns = int64_t(plot_window_seconds * 1e9);
+
+    ImVec2 pos;
+    auto size = BeginPlotCanvas("##scatter", std::min(ImGui::GetContentRegionAvail().x, 300.f), pos);
+    size.x = size.y;
+    auto draw = ImGui::GetWindowDrawList();
+    auto to_point = [&](float x, float y) {
+        return ImVec2(pos.x + size.x * (0.5f + 0.5f * std::clamp(x, -1.f, 1.f)), pos.y + size.y * (0.5f - 0.5f * std::clamp(y, -1.f, 1.f)));
+    };
+    draw->AddLine(to_point(-1.f, 0.f), to_point(1.f, 0.f), ImGui::GetColorU32(ImGuiCol_Border));
+    draw->AddLine(to_point(0.f, -1.f), to_point(0.f, 1.f), ImGui::GetColorU32(ImGuiCol_Border));
+
+    auto color = ImGui::GetColorU32(ImGuiCol_PlotHistogram);
+    auto x_count = std::min<uint64_t>(xs.count, state_plot_capacity);
+    auto y_count = std::min<uint64_t>(ys.count, state_plot_capacity);
+    for (uint64_t xi = 0, yi = 0; xi < x_count && yi < y_count;) {
+        auto& x = xs.FromNewest(xi);
+        auto& y = ys.FromNewest(yi);
+        if (now_ns - std::max(x.time_ns, y.time_ns) > window_ns) break;
+
+        draw->AddCircleFilled(to_point(x.value, y.value), 1.5f, color);
+        if (x.time_ns >= y.time_ns) ++xi;
+        if (y.time_ns >= x.time_ns) ++yi;
+    }
+}
+
+static
+void DrawPlotsPanel()
+{
+    Defer _ = [] { ImGui::End(); };
+    plots_visible = ImGui::Begin("Plots");
+    if (!plots_visible) return;
+
+    ImGui::SliderFloat("Window (s)", &plot_window_seconds, 0.5f, 30.f, "%.1f");
+
+    auto now_ns = StateClockNow();
+    bool any = false;
+
+    for (uint32_t i = 0; i < state_max_plot_channels; ++i) {
+        auto& channel = plot_selection.channels[i];
+        if (channel.source == PlotSource::None) continue;
+        any = true;
+
+        ImGui_IDGuard _ = int(i);
+        auto kind = channel.source == PlotSource::JoystickAxis ? "Input" : "Output";
+        ImGui_Print("[{}] {} axis {} ({})", i, PlotDeviceName(channel), channel.index, kind);
+        ImGui::SameLine();
+        if (ImGui::SmallButton("Remove")) {
+            channel = {};
+            continue;
+        }
+
+        DrawTimeSeries(i, now_ns);
+    }
+
+    if (!any) {
+        ImGui::TextWrapped("Tick the checkbox next to any joystick or virtual joystick axis to plot it here.");
+        return;
+    }
+
+    ImGui::SeparatorText("Scatter");
+
+    auto channel_combo = [](const char* label, int* selected) {
+        auto preview = *selected >= 0 ? ImGui_Format("[{}]", *selected) : "None";
+        if (!ImGui::BeginCombo(label, preview)) return;
+        for (uint32_t i = 0; i < state_max_plot_channels; ++i) {
+            auto& channel = plot_selection.channels[i];
+            if (channel.source == PlotSource::None) continue;
+            if (ImGui::Selectable(ImGui_Format("[{}] {} axis {}", i, PlotDeviceName(channel), channel.index), *selected == int(i))) {
+                *selected = int(i);
+            }
+        }
+        ImGui::EndCombo();
+    };
+
+    channel_combo("X (input)", &plot_scatter_x);
+    channel_combo("Y (output)", &plot_scatter_y);
+
+    auto valid = [](int i) { return i >= 0 && plot_selection.channels[i].source != PlotSource::None; };
+    if (valid(plot_scatter_x) && valid(plot_scatter_y)) {
+        DrawScatter(uint32_t(plot_scatter_x), uint32_t(plot_scatter_y), now_ns);
+    }
+}
+
+// -----------------------------------------------------------------------------
+
 static
-void DrawLoadedScriptPanel(SharedLockGuard& lock)
+void DrawLoadedScriptPanel()
 {
     Defer _ = [] { ImGui::End(); };
     if (!ImGui::Begin("Scripts")) return;
 
-    for (auto& script : scripts) {
-        ImGui_IDGuard _ = script;
+    for (uint32_t i = 0; i < state.num_scripts; ++i) {
+        auto& script = state.scripts[i];
+        ImGui_IDGuard _ = script.path.c_str();
         {
-            if (script->disabled) ImGui::PushStyleColor(ImGuiCol_Text, ImGui::GetColorU32({ 1.f, 0.f, 0.f, 1.f }));
-            Defer _ = [&] { if (script->disabled) ImGui::PopStyleColor(); };
-            if (!ImGui::CollapsingHeader(std::format("{}{}###", script->path.string(), script->disabled ? " (DISABLED)" : "").c_str())) continue;
+            if (script.disabled) ImGui::PushStyleColor(ImGuiCol_Text, ImGui::GetColorU32({ 1.f, 0.f, 0.f, 1.f }));
+            Defer _ = [&] { if (script.disabled) ImGui::PopStyleColor(); };
+            if (!ImGui::CollapsingHeader(ImGui_Format("{}{}###", script.path.c_str(), script.disabled ? " (DISABLED)" : script.dormant ? " (DORMANT)" : ""))) continue;
         }
 
         if (ImGui::Button("Unload")) {
-            QueueUnloadScript(script);
+            connection.Send({ .type = CommandType::UnloadScript, .path = script.path.c_str() });
         }
 
         ImGui::SameLine();
 
         if (ImGui::Button("Reload")) {
-            LoadScript(script);
+            connection.Send({ .type = CommandType::ReloadScript, .path = script.path.c_str() });
         }
 
-        if (script->disabled) {
+        ImGui_Print("Memory: {} live, {} peak, {} reserved", BytesToString(script.memory_live), BytesToString(script.memory_peak), BytesToString(script.memory_reserved));
+        if (script.memory_limit) {
+            ImGui_Print("Memory Limit: {} ({} failed allocations)", BytesToString(script.memory_limit), script.failed_allocations);
+        }
+
+        if (!script.jit_enabled) {
+            ImGui_Print("JIT: off");
+        } else {
+            ImGui_Print("JIT: {} traces, {} aborts, {} flushes", script.jit_traces, script.jit_aborts, script.jit_flushes);
+        }
+        if (script.jit_profiling) {
+            auto lua_samples = script.jit_samples_traced + script.jit_samples_interpreted;
+            ImGui_Print("JIT Profile: {:.1f}% traced, {} traced / {} interpreted / {} GC / {} compiler / {} host samples",
+                lua_samples ? 100.0 * double(script.jit_samples_traced) / double(lua_samples) : 0.0,
+                script.jit_samples_traced, script.jit_samples_interpreted, script.jit_samples_gc, script.jit_samples_compiler, script.jit_samples_host);
+        }
+        if (script.num_jit_abort_sites && ImGui::TreeNode("Trace Aborts")) {
+            Defer _ = [] { ImGui::TreePop(); };
+            for (uint32_t j = 0; j < script.num_jit_abort_sites; ++j) {
+                auto& site = script.jit_abort_sites[j];
+                ImGui_Print("{}x {}: {}", site.count, site.location.c_str(), site.reason.c_str());
+            }
+        }
+
+        if (script.disabled) {
             ImGui_Print("Disabled, reason:");
-            ImGui::TextWrapped("%s", script->error.c_str());
+            ImGui::TextWrapped("%s", script.error.c_str());
         }
     }
-
-    FlushScriptDeleteQueue(lock);
 }
 
 static
@@ -278,46 +662,54 @@ void DrawVirtualJoysticksPanel()
 
     ImGui::SetCursorPosY(ImGui::GetCursorPosY() + ImGui_TopWindowPaddingAdjustment);
 
-    bool any_change = false;
+    for (uint32_t j = 0; j < state.num_vjoysticks; ++j) {
+        auto& vjoy = state.vjoysticks[j];
+        ImGui_IDGuard _ = reinterpret_cast<const void*>(uintptr_t(vjoy.id));
 
-    for (auto* script : scripts) {
-        for (auto* vjoy : script->vjoysticks) {
-            ImGui_IDGuard _ = vjoy;
+        if (!ImGui::CollapsingHeader(vjoy.name.c_str())) continue;
 
-            if (!ImGui::CollapsingHeader(std::format("{}", vjoy->name).c_str())) continue;
+        ImGui_Print("Reports: {} emitted, {} coalesced", vjoy.reports_emitted, vjoy.reports_coalesced);
+        if (vjoy.force_feedback) {
+            ImGui_Print("Force Feedback: {} uploaded, {} played, {} dropped, {} round trip",
+                vjoy.ff_uploads, vjoy.ff_plays, vjoy.ff_dropped, DurationToString(std::chrono::nanoseconds(vjoy.ff_round_trip_ns)));
+        }
 
-            if (ImGui::Button("Reset", ImVec2(100, 0))) {
-                for (uint32_t i = 0; i < vjoy->num_axes; ++i) {
-                    vjoy->SetAxis(i, 0.f);
-                }
-                for (uint32_t i = 0; i < vjoy->num_buttons; ++i) {
-                    vjoy->SetButton(i, false);
-                }
-                any_change = true;
-            }
+        if (ImGui::Button("Reset", ImVec2(100, 0))) {
+            connection.Send({ .type = CommandType::ResetVirtualJoystick, .target = vjoy.id });
+        }
 
-            for (uint32_t i = 0; i < vjoy->num_axes; ++i) {
-                float v = vjoy->GetAxis(i);
-                if (ImGui::SliderFloat(std::format("{}##axis", i).c_str(), &v, -1.f, 1.f)) {
-                    vjoy->SetAxis(i, v);
-                    any_change = true;
-                }
+        for (uint32_t i = 0; i < vjoy.num_axes; ++i) {
+            DrawPlotToggle(PlotSource::VirtualJoystickAxis, vjoy.id, i);
+            float v = vjoy.axes[i];
+            if (ImGui::SliderFloat(ImGui_Format("{}##axis", i), &v, -1.f, 1.f)) {
+                connection.Send({ .type = CommandType::SetAxis, .target = vjoy.id, .index = i, .value = v });
             }
+        }
 
-            for (uint32_t i = 0; i < vjoy->num_buttons; ++i) {
-                bool pressed = vjoy->GetButton(i);
+        for (uint32_t i = 0; i < vjoy.num_buttons; ++i) {
+            bool pressed = vjoy.buttons[i];
 
-                if (i > 0 && i % 8) ImGui::SameLine(0.f, ImGui_ToggleButtonSpacing);
-                if (ImGui_ToggleButton(std::format("{}##button", i).c_str(), {30, 30}, &pressed, true)) {
-                    vjoy->SetButton(i, pressed);
-                    any_change = true;
-                }
+            if (i > 0 && i % 8) ImGui::SameLine(0.f, ImGui_ToggleButtonSpacing);
+            if (ImGui_ToggleButton(ImGui_Format("{}##button", i), {30, 30}, &pressed, true)) {
+                connection.Send({ .type = CommandType::SetButton, .target = vjoy.id, .index = i, .value = pressed ? 1.f : 0.f });
             }
         }
     }
 
-    if (any_change) {
-        PushJoystickUpdateEvent();
+    for (uint32_t i = 0; i < state.num_vmice; ++i) {
+        auto& mouse = state.vmice[i];
+        ImGui_IDGuard _ = int(i);
+        if (!ImGui::CollapsingHeader(ImGui_Format("{} (Mouse)", mouse.name.c_str()))) continue;
+        ImGui_Print("Velocity: ({:.1f}, {:.1f})", mouse.velocity_x, mouse.velocity_y);
+        ImGui_Print("Reports: {}", mouse.reports_emitted);
+    }
+
+    for (uint32_t i = 0; i < state.num_vkeyboards; ++i) {
+        auto& keyboard = state.vkeyboards[i];
+        ImGui_IDGuard _ = int(state_max_vdevices + i);
+        if (!ImGui::CollapsingHeader(ImGui_Format("{} (Keyboard)", keyboard.name.c_str()))) continue;
+        ImGui_Print("Keys held: {}", keyboard.keys_held);
+        ImGui_Print("Reports: {}", keyboard.reports_emitted);
     }
 }
 
@@ -329,39 +721,33 @@ void DrawJoystickInputViewer()
 
     ImGui::SetCursorPosY(ImGui::GetCursorPosY() + ImGui_TopWindowPaddingAdjustment);
 
-    for (auto joystick : joysticks) {
-        auto name = SDL_GetJoystickName(joystick);
-        auto vendor_id = SDL_GetJoystickVendor(joystick);
-        auto product_id = SDL_GetJoystickProduct(joystick);
-        auto version = SDL_GetJoystickProductVersion(joystick);
-
-        auto guid = SDL_GetJoystickGUID(joystick);
-        /* SDL_GUID : (bus_type, 0, vendor_id, 0, product_id, 0, version, 0) */
-        uint16_t bus_type;
-        std::memcpy(&bus_type, guid.data, 2);
+    for (uint32_t j = 0; j < state.num_joysticks; ++j) {
+        auto& joystick = state.joysticks[j];
 
-        ImGui_IDGuard _ = joystick;
+        ImGui_IDGuard _ = int(j);
 
-        if (!ImGui::CollapsingHeader(std::format("({:#06x}/{:#06x}/{:#06x}/{:#06x}) {}", bus_type, vendor_id, product_id, version, name).c_str())) continue;
+        if (!ImGui::CollapsingHeader(ImGui_Format("({:#06x}/{:#06x}/{:#06x}/{:#06x}) {}",
+                joystick.bus_type, joystick.vendor_id, joystick.product_id, joystick.version, joystick.name.c_str()))) continue;
 
-        ImGui::PushItemFlag(ImGuiItemFlags_Disabled, true);
-        for (int i = 0; i < SDL_GetNumJoystickAxes(joystick); ++i) {
-            auto raw = SDL_GetJoystickAxis(joystick, i);
+        for (uint32_t i = 0; i < joystick.num_axes; ++i) {
+            DrawPlotToggle(PlotSource::JoystickAxis, joystick.id, i);
 
+            auto raw = joystick.axes[i];
             auto normalized = FromSNorm(raw);
-            ImGui::SliderFloat(std::format("{} ({})###axis.{}", i, raw, i).c_str(), &normalized, -1.f, 1.f, "%.3f", ImGuiSliderFlags_NoInput);
+            ImGui::PushItemFlag(ImGuiItemFlags_Disabled, true);
+            ImGui::SliderFloat(ImGui_Format("{} ({})###axis.{}", i, raw, i), &normalized, -1.f, 1.f, "%.3f", ImGuiSliderFlags_NoInput);
+            ImGui::PopItemFlag();
         }
-        ImGui::PopItemFlag();
 
-        for (int i = 0; i < SDL_GetNumJoystickButtons(joystick); ++i) {
-            auto pressed = SDL_GetJoystickButton(joystick, i);
+        for (uint32_t i = 0; i < joystick.num_buttons; ++i) {
+            bool pressed = joystick.buttons[i];
 
             if (i > 0 && i % 8) ImGui::SameLine(0.f, ImGui_ToggleButtonSpacing);
-            ImGui_ToggleButton(std::format("{}##button", i).c_str(), {30, 30}, &pressed, false);
+            ImGui_ToggleButton(ImGui_Format("{}##button", i), {30, 30}, &pressed, false);
         }
 
-        for (int i = 0; i < SDL_GetNumJoystickHats(joystick); ++i) {
-            auto hat = SDL_GetJoystickHat(joystick, i);
+        for (uint32_t i = 0; i < joystick.num_hats; ++i) {
+            auto hat = joystick.hats[i];
 
             const char* hat_str = "?";
             switch (hat) {
@@ -379,6 +765,17 @@ void DrawJoystickInputViewer()
             ImGui_Print("Hat[{}] = {}", i, hat_str);
         }
     }
+
+    for (uint32_t i = 0; i < state.num_input_devices; ++i) {
+        auto& device = state.input_devices[i];
+        ImGui_IDGuard _ = int(state_max_joysticks + i);
+
+        if (!ImGui::CollapsingHeader(ImGui_Format("{}{}", device.name.c_str(), device.grab ? " (grabbed)" : ""))) continue;
+
+        ImGui_Print("Events: {} in {} frames", device.events_received, device.frames);
+        ImGui_Print("Keys held: {}", device.keys_held);
+        ImGui_Print("Relative: ({}, {}) Wheel: ({}, {})", device.rel_x, device.rel_y, device.wheel, device.hwheel);
+    }
 }
 
 static
@@ -387,9 +784,79 @@ void DrawStatsPanel()
     Defer _ = [] { ImGui::End(); };
     if (!ImGui::Begin("Stats")) return;
 
-    ImGui_Print("Joystick Updates: {}", frame);
+    auto& stats = state.stats;
+    ImGui_Print("Joystick Updates: {}", stats.frame);
     ImGui_Print("GUI Frames: {}", gui_frame);
-    ImGui_Print("Script Time: {} ({:.3f}%)", DurationToString(average_script_dur), average_script_util * 100.f);
+    ImGui_Print("Script Time: {} ({:.3f}%)", DurationToString(std::chrono::nanoseconds(stats.average_script_ns)), stats.average_script_util * 100.f);
+    ImGui_Print("Script Memory: {}", BytesToString(stats.script_memory));
+    ImGui_Print("Bytecode Cache: {} hits, {} misses, {} saved",
+        stats.bytecode_cache_hits, stats.bytecode_cache_misses, DurationToString(std::chrono::nanoseconds(stats.bytecode_cache_saved_ns)));
+    ImGui_Print("Axis Events: {} raw, {} gated ({:.1f}%)", stats.axis_events_raw, stats.axis_events_gated,
+        stats.axis_events_raw ? 100.0 * double(stats.axis_events_gated) / double(stats.axis_events_raw) : 0.0);
+
+    for (uint32_t i = 0; i < state.num_gated_axes; ++i) {
+        auto& axis = state.gated_axes[i];
+        auto joystick = std::ranges::find(state.joysticks.begin(), state.joysticks.begin() + state.num_joysticks, axis.joystick, &JoystickState::id);
+        ImGui_Print("  {} axis {}: {} raw, {} gated ({:.1f}%)",
+            joystick != state.joysticks.begin() + state.num_joysticks ? joystick->name.c_str() : "Unknown", axis.axis,
+            axis.raw_events, axis.gated_events,
+            axis.raw_events ? 100.0 * double(axis.gated_events) / double(axis.raw_events) : 0.0);
+    }
+}
+
+static
+void DrawLockTimeHistogram(const char* label, const LockTimeState& time)
+{
+    std::array<float, state_lock_histogram_buckets> values;
+    for (uint32_t i = 0; i < state_lock_histogram_buckets; ++i) values[i] = float(time.histogram[i]);
+    ImGui::PlotHistogram(label, values.data(), int(values.size()), 0,
+        ImGui_Format("max {}", DurationToString(std::chrono::nanoseconds(time.max_ns))),
+        0.f, FLT_MAX, ImVec2(0.f, 60.f));
+}
+
+static
+void DrawLocksPanel()
+{
+    Defer _ = [] { ImGui::End(); };
+    if (!ImGui::Begin("Locks")) return;
+
+    if (!lock_stats.enabled) {
+        ImGui::TextUnformatted("Lock statistics are not available, rebuild with MAPPER_LOCK_STATS enabled");
+        return;
+    }
+
+    // Most contended sites first
+    struct Entry { const LockSiteState* site; uint32_t mode; };
+    std::vector<Entry> entries;
+    for (uint32_t i = 0; i < lock_stats.num_sites; ++i) {
+        for (uint32_t mode = 0; mode < 2; ++mode) {
+            if (lock_stats.sites[i].modes[mode].acquisitions) entries.push_back({ &lock_stats.sites[i], mode });
+        }
+    }
+    std::ranges::sort(entries, std::greater{}, [](const Entry& e) { return e.site->modes[e.mode].wait.total_ns; });
+
+    ImGui::TextUnformatted("Buckets are powers of two from 1us");
+
+    for (auto& entry : entries) {
+        auto& site = *entry.site;
+        auto& mode = site.modes[entry.mode];
+        auto average = [&](const LockTimeState& time) {
+            return DurationToString(std::chrono::nanoseconds(time.total_ns / mode.acquisitions));
+        };
+
+        ImGui::PushID(&mode);
+        Defer _ = [] { ImGui::PopID(); };
+
+        if (!ImGui::CollapsingHeader(ImGui_Format("{}:{} ({}) - {} waited",
+                site.file.c_str(), site.line, entry.mode ? "unique" : "shared",
+                DurationToString(std::chrono::nanoseconds(mode.wait.total_ns))))) continue;
+
+        ImGui_Print("Acquisitions: {}", mode.acquisitions);
+        ImGui_Print("Wait: {} avg, {} max", average(mode.wait), DurationToString(std::chrono::nanoseconds(mode.wait.max_ns)));
+        ImGui_Print("Hold: {} avg, {} max", average(mode.hold), DurationToString(std::chrono::nanoseconds(mode.hold.max_ns)));
+        DrawLockTimeHistogram("Wait", mode.wait);
+        DrawLockTimeHistogram("Hold", mode.hold);
+    }
 }
 
 void DrawGUI()
@@ -398,12 +865,11 @@ void DrawGUI()
     BeginFrame([] {
         DrawFileMenu();
     });
-    {
-        SharedLockGuard lock{ engine_mutex, LockState::Shared };
-        DrawLoadedScriptPanel(lock);
-        DrawVirtualJoysticksPanel();
-        DrawJoystickInputViewer();
-        DrawStatsPanel();
-    }
+    DrawLoadedScriptPanel();
+    DrawVirtualJoysticksPanel();
+    DrawJoystickInputViewer();
+    DrawStatsPanel();
+    DrawPlotsPanel();
+    DrawLocksPanel();
     EndFrame();
 }
@@ -0,0 +1,16 @@
+#pragma once
+
+#include <cstdint>
+
+// -----------------------------------------------------------------------------
+//          GUI
+// -----------------------------------------------------------------------------
+
+// Only the mapper executable links the GUI, mapper_core and mapper_headless never see these
+
+inline uint64_t gui_frame = 0;
+inline double gui_max_fps = 60.0;
+
+void OpenGUI();
+void CloseGUI();
+int RunGUIClient();
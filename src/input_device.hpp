@@ -0,0 +1,78 @@
+#pragma once
+
+#include "vinput.hpp"
+
+#include <string>
+
+#include <atomic>
+#include <bitset>
+#include <cstdint>
+#include <mutex>
+
+// -----------------------------------------------------------------------------
+//          Input Devices
+// -----------------------------------------------------------------------------
+
+// Keyboards and mice read directly from the OS, outside of SDL. Events are
+// accumulated on a reader thread and folded into a per-frame snapshot when
+// the engine runs, so high rate devices cost one engine wakeup per frame.
+
+struct InputDeviceDesc
+{
+    // Device node, or a file of recorded input events to replay
+    std::string path = {};
+
+    // Take exclusive access, suppressing the original events
+    bool grab = false;
+
+    // Restart recordings once they reach the end
+    bool loop = false;
+};
+
+struct InputDeviceState
+{
+    std::bitset<max_key_code + 1> keys;
+
+    // Keys pressed at any point during the frame, so short taps are never lost
+    std::bitset<max_key_code + 1> pressed;
+
+    int32_t rel_x = 0;
+    int32_t rel_y = 0;
+    int32_t wheel = 0;
+    int32_t hwheel = 0;
+};
+
+struct InputDevice : InputDeviceDesc
+{
+    std::string name;
+
+    // Written by the reader thread
+    std::mutex mutex;
+    InputDeviceState pending;
+    std::atomic<bool> wake_pending = false;
+    std::atomic<uint64_t> events_received = 0;
+
+    // Read by scripts, updated once per frame
+    InputDeviceState state;
+    uint64_t frames = 0;
+
+    void Destroy();
+
+    void Snapshot()
+    {
+        {
+            std::scoped_lock _{ mutex };
+
+            // Cleared under the lock, so a frame flushed after this snapshot always wakes the engine again
+            wake_pending = false;
+            state = pending;
+
+            // Every press so far is delivered with this snapshot, WasPressed only reports new edges
+            pending.pressed.reset();
+            pending.rel_x = pending.rel_y = pending.wheel = pending.hwheel = 0;
+        }
+        ++frames;
+    }
+};
+
+InputDevice* OpenInputDevice(const InputDeviceDesc& desc);
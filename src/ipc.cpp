@@ -0,0 +1,468 @@
+#include "mapper.hpp"
+
+#include <charconv>
+#include <mutex>
+
+// -----------------------------------------------------------------------------
+//          Command Parsing
+// -----------------------------------------------------------------------------
+
+template<typename T>
+static
+bool ParseValue(std::string_view& str, T& value)
+{
+    while (str.starts_with(' ')) str.remove_prefix(1);
+    auto res = std::from_chars(str.data(), str.data() + str.size(), value);
+    if (res.ec != std::errc{}) return false;
+    str.remove_prefix(size_t(res.ptr - str.data()));
+    return true;
+}
+
+std::optional<Command> ParseCommand(std::string_view line)
+{
+    while (line.ends_with('\n') || line.ends_with('\r') || line.ends_with(' ')) line.remove_suffix(1);
+
+    auto split = line.find(' ');
+    auto verb = line.substr(0, split);
+    auto args = split == line.npos ? std::string_view{} : line.substr(split + 1);
+
+    if (verb == "load" || verb == "reload" || verb == "unload") {
+        if (args.empty()) return std::nullopt;
+        return Command {
+            .type = verb == "load" ? CommandType::LoadScript : verb == "reload" ? CommandType::ReloadScript : CommandType::UnloadScript,
+            .path = std::string(args),
+        };
+    }
+
+    Command command;
+    if (verb == "set-axis") {
+        command.type = CommandType::SetAxis;
+        if (!ParseValue(args, command.target) || !ParseValue(args, command.index) || !ParseValue(args, command.value)) return std::nullopt;
+        return command;
+    }
+
+    if (verb == "set-button") {
+        command.type = CommandType::SetButton;
+        if (!ParseValue(args, command.target) || !ParseValue(args, command.index) || !ParseValue(args, command.value)) return std::nullopt;
+        return command;
+    }
+
+    if (verb == "refresh") {
+        return Command { .type = CommandType::Refresh };
+    }
+
+    if (verb == "trace") {
+        return Command { .type = CommandType::WriteTrace };
+    }
+
+    if (verb == "reset") {
+        command.type = CommandType::ResetVirtualJoystick;
+        if (!ParseValue(args, command.target)) return std::nullopt;
+        return command;
+    }
+
+    return std::nullopt;
+}
+
+std::string FormatCommand(const Command& command)
+{
+    switch (command.type) {
+        case CommandType::LoadScript:           return std::format("load {}\n", command.path);
+        case CommandType::ReloadScript:         return std::format("reload {}\n", command.path);
+        case CommandType::UnloadScript:         return std::format("unload {}\n", command.path);
+        case CommandType::SetAxis:              return std::format("set-axis {} {} {}\n", command.target, command.index, command.value);
+        case CommandType::SetButton:            return std::format("set-button {} {} {}\n", command.target, command.index, command.value);
+        case CommandType::ResetVirtualJoystick: return std::format("reset {}\n", command.target);
+        case CommandType::Refresh:              return "refresh\n";
+        case CommandType::WriteTrace:           return "trace\n";
+    }
+    return {};
+}
+
+// -----------------------------------------------------------------------------
+//          Command Queue
+// -----------------------------------------------------------------------------
+
+static std::mutex command_mutex;
+static std::vector<Command> command_queue;
+static std::atomic<bool> commands_pending = false;
+
+void QueueCommand(Command command)
+{
+    {
+        std::scoped_lock _{ command_mutex };
+        command_queue.emplace_back(std::move(command));
+    }
+    commands_pending = true;
+    PushJoystickUpdateEvent();
+}
+
+static
+VirtualJoystick* FindVirtualJoystick(uint64_t id)
+{
+    for (auto* script : scripts) {
+        for (auto* vjoy : script->vjoysticks) {
+            if (vjoy->id == id) return vjoy;
+        }
+    }
+    LogWarn("No virtual joystick with id {}", id);
+    return nullptr;
+}
+
+static
+void ExecuteCommand(const Command& command)
+{
+    switch (command.type) {
+        case CommandType::LoadScript:
+            Log("Loading script: {}", command.path);
+            LoadScript(std::filesystem::path(command.path));
+            break;
+        case CommandType::ReloadScript:
+            for (auto* script : scripts) {
+                if (script->path == command.path) LoadScript(script);
+            }
+            break;
+        case CommandType::UnloadScript:
+            UnloadScript(command.path);
+            break;
+        case CommandType::SetAxis:
+            if (auto vjoy = FindVirtualJoystick(command.target); vjoy && command.index < vjoy->num_axes) {
+                vjoy->SetAxis(command.index, command.value);
+            }
+            break;
+        case CommandType::SetButton:
+            if (auto vjoy = FindVirtualJoystick(command.target); vjoy && command.index < vjoy->num_buttons) {
+                vjoy->SetButton(command.index, command.value != 0.f);
+            }
+            break;
+        case CommandType::ResetVirtualJoystick:
+            if (auto vjoy = FindVirtualJoystick(command.target)) {
+                for (uint32_t i = 0; i < vjoy->num_axes; ++i) vjoy->SetAxis(i, 0.f);
+                for (uint32_t i = 0; i < vjoy->num_buttons; ++i) vjoy->SetButton(i, false);
+            }
+            break;
+        case CommandType::Refresh:
+            break;
+        case CommandType::WriteTrace:
+            WriteTrace();
+            break;
+    }
+}
+
+bool ExecuteQueuedCommands()
+{
+    if (!commands_pending.exchange(false)) return false;
+
+    std::vector<Command> commands;
+    {
+        std::scoped_lock _{ command_mutex };
+        std::swap(commands, command_queue);
+    }
+
+    SharedLockGuard _{ engine_mutex, LockState::Unique };
+
+    for (auto& command : commands) {
+        try {
+            ExecuteCommand(command);
+        } catch (const std::exception& e) {
+            Log("Error executing command [{}]: {}", FormatCommand(command), e.what());
+        }
+    }
+
+    return !commands.empty();
+}
+
+// -----------------------------------------------------------------------------
+//          State Publishing
+// -----------------------------------------------------------------------------
+
+static
+void CaptureLockStats([[maybe_unused]] LockStatsState& state)
+{
+    state.enabled = lock_stats_enabled;
+    state.num_sites = 0;
+
+#if defined(MAPPER_LOCK_STATS)
+    static_assert(lock_histogram_buckets == state_lock_histogram_buckets);
+
+    auto copy_time = [](LockTimeState& out, const LockTimeStats& in) {
+        out.total_ns = in.total_ns.load(std::memory_order_relaxed);
+        out.max_ns = in.max_ns.load(std::memory_order_relaxed);
+        for (uint32_t i = 0; i < lock_histogram_buckets; ++i) {
+            out.histogram[i] = in.histogram[i].load(std::memory_order_relaxed);
+        }
+    };
+
+    for (auto& site : GetLockSites()) {
+        if (state.num_sites >= state_max_lock_sites) break;
+        if (!site.ready.load(std::memory_order_acquire)) break;
+
+        auto& out = state.sites[state.num_sites++];
+        auto file = std::string_view(site.file.load(std::memory_order_relaxed));
+        out.file.Set(file.substr(file.find_last_of("/\\") + 1));
+        out.line = site.line.load(std::memory_order_relaxed);
+        for (uint32_t i = 0; i < 2; ++i) {
+            out.modes[i].acquisitions = site.modes[i].acquisitions.load(std::memory_order_relaxed);
+            copy_time(out.modes[i].wait, site.modes[i].wait);
+            copy_time(out.modes[i].hold, site.modes[i].hold);
+        }
+    }
+#endif
+}
+
+static
+void CaptureState(EngineState& state)
+{
+    state.stats = {
+        .frame = frame,
+        .average_script_ns = int64_t(average_script_dur.count()),
+        .average_script_util = average_script_util,
+        .script_memory = 0,
+        .bytecode_cache_hits = bytecode_cache_hits,
+        .bytecode_cache_misses = bytecode_cache_misses,
+        .bytecode_cache_saved_ns = int64_t(bytecode_cache_saved.count()),
+        .axis_events_raw = noise_gates.raw_events,
+        .axis_events_gated = noise_gates.gated_events,
+    };
+
+    state.num_scripts = 0;
+    state.num_vjoysticks = 0;
+    state.num_vmice = 0;
+    state.num_vkeyboards = 0;
+    state.num_input_devices = 0;
+
+    for (auto* script : scripts) {
+        state.stats.script_memory += script->arena.live.Get();
+
+        if (state.num_scripts < state_max_scripts) {
+            auto& out = state.scripts[state.num_scripts++];
+            out.path.Set(script->path.string());
+            out.error.Set(script->error);
+            out.disabled = script->disabled;
+            out.dormant = script->dormant;
+            out.memory_live = script->arena.live.Get();
+            out.memory_peak = script->arena.peak.Get();
+            out.memory_reserved = script->arena.reserved.Get();
+            out.memory_limit = script->arena.limit.Get();
+            out.failed_allocations = script->arena.failed_allocations.Get();
+
+            auto& jit = script->jit;
+            out.jit_enabled = script->jit_enabled;
+            out.jit_traces = jit.traces;
+            out.jit_aborts = jit.aborts;
+            out.jit_flushes = jit.flushes;
+            out.num_jit_abort_sites = 0;
+            for (auto& site : jit.abort_sites) {
+                if (out.num_jit_abort_sites >= state_max_jit_aborts) break;
+                auto& out_site = out.jit_abort_sites[out.num_jit_abort_sites++];
+                out_site.location.Set(site.location);
+                out_site.reason.Set(site.reason);
+                out_site.count = site.count;
+            }
+            out.jit_profiling = jit.profiling;
+            out.jit_samples_traced = jit.samples_traced;
+            out.jit_samples_interpreted = jit.samples_interpreted;
+            out.jit_samples_host = jit.samples_host;
+            out.jit_samples_gc = jit.samples_gc;
+            out.jit_samples_compiler = jit.samples_compiler;
+        }
+
+        for (auto* vjoy : script->vjoysticks) {
+            if (state.num_vjoysticks >= state_max_vjoysticks) break;
+            auto& out = state.vjoysticks[state.num_vjoysticks++];
+            out.id = vjoy->id;
+            out.name.Set(vjoy->name);
+            out.num_axes = std::min<uint32_t>(vjoy->num_axes, state_max_vjoystick_axes);
+            out.num_buttons = std::min<uint32_t>(vjoy->num_buttons, state_max_vjoystick_buttons);
+            std::copy_n(vjoy->axes.begin(), out.num_axes, out.axes.begin());
+            std::copy_n(vjoy->buttons.begin(), out.num_buttons, out.buttons.begin());
+            out.reports_emitted = vjoy->reports_emitted;
+            out.reports_coalesced = vjoy->reports_coalesced;
+            out.force_feedback = vjoy->force_feedback;
+            out.ff_uploads = vjoy->ff_stats.uploads;
+            out.ff_plays = vjoy->ff_stats.plays;
+            out.ff_dropped = vjoy->ff_stats.dropped;
+            out.ff_round_trip_ns = vjoy->ff_stats.average_round_trip_ns;
+        }
+
+        for (auto* mouse : script->vmice) {
+            if (state.num_vmice >= state_max_vdevices) break;
+            auto& out = state.vmice[state.num_vmice++];
+            out.name.Set(mouse->name);
+            out.velocity_x = mouse->velocity_x;
+            out.velocity_y = mouse->velocity_y;
+            out.reports_emitted = mouse->reports_emitted;
+        }
+
+        for (auto* keyboard : script->vkeyboards) {
+            if (state.num_vkeyboards >= state_max_vdevices) break;
+            auto& out = state.vkeyboards[state.num_vkeyboards++];
+            out.name.Set(keyboard->name);
+            out.keys_held = uint32_t(keyboard->keys.count());
+            out.reports_emitted = keyboard->reports_emitted;
+        }
+
+        for (auto* device : script->input_devices) {
+            if (state.num_input_devices >= state_max_input_devices) break;
+            auto& out = state.input_devices[state.num_input_devices++];
+            out.name.Set(device->name);
+            out.grab = device->grab;
+            out.events_received = device->events_received;
+            out.frames = device->frames;
+            out.keys_held = uint32_t(device->state.keys.count());
+            out.rel_x = device->state.rel_x;
+            out.rel_y = device->state.rel_y;
+            out.wheel = device->state.wheel;
+            out.hwheel = device->state.hwheel;
+        }
+    }
+
+    state.num_joysticks = 0;
+    for (auto* joystick : joysticks) {
+        if (state.num_joysticks >= state_max_joysticks) break;
+        auto& out = state.joysticks[state.num_joysticks++];
+
+        auto name = SDL_GetJoystickName(joystick);
+        out.id = SDL_GetJoystickID(joystick);
+        out.name.Set(name ? name : "");
+        out.vendor_id = SDL_GetJoystickVendor(joystick);
+        out.product_id = SDL_GetJoystickProduct(joystick);
+        out.version = SDL_GetJoystickProductVersion(joystick);
+
+        auto guid = SDL_GetJoystickGUID(joystick);
+        /* SDL_GUID : (bus_type, 0, vendor_id, 0, product_id, 0, version, 0) */
+        std::memcpy(&out.bus_type, guid.data, 2);
+
+        out.num_axes = std::min<uint32_t>(std::max(SDL_GetNumJoystickAxes(joystick), 0), state_max_joystick_axes);
+        out.num_buttons = std::min<uint32_t>(std::max(SDL_GetNumJoystickButtons(joystick), 0), state_max_joystick_buttons);
+        out.num_hats = std::min<uint32_t>(std::max(SDL_GetNumJoystickHats(joystick), 0), state_max_joystick_hats);
+        for (uint32_t i = 0; i < out.num_axes; ++i)    out.axes[i]    = SDL_GetJoystickAxis(joystick, int(i));
+        for (uint32_t i = 0; i < out.num_buttons; ++i) out.buttons[i] = SDL_GetJoystickButton(joystick, int(i));
+        for (uint32_t i = 0; i < out.num_hats; ++i)    out.hats[i]    = SDL_GetJoystickHat(joystick, int(i));
+    }
+
+    state.num_gated_axes = 0;
+    for (auto& [key, axis] : noise_gates.axes) {
+        if (state.num_gated_axes >= state_max_gated_axes) break;
+        state.gated_axes[state.num_gated_axes++] = {
+            .joystick = uint32_t(key >> 16),
+            .axis = uint32_t(key & 0xFFFF),
+            .raw_events = axis.raw_events,
+            .gated_events = axis.gated_events,
+        };
+    }
+}
+
+static int64_t last_publish = 0;
+
+void PublishState()
+{
+    if (!state_region) return;
+
+    // Skip the copy entirely while nobody is watching
+    auto now = StateClockNow();
+    if (now - state_region->reader_heartbeat_ns.load(std::memory_order_relaxed) > state_reader_timeout_ns) {
+        state_publish_deadline = std::nullopt;
+        return;
+    }
+
+    // Don't publish faster than the reader draws, but make sure the latest state goes out eventually
+    auto next_publish = last_publish + state_region->reader_interval_ns.load(std::memory_order_relaxed);
+    if (now < next_publish) {
+        state_publish_deadline = std::chrono::steady_clock::time_point(std::chrono::nanoseconds(next_publish));
+        return;
+    }
+    last_publish = now;
+    state_publish_deadline = std::nullopt;
+
+    SharedLockGuard _{ engine_mutex, LockState::Shared };
+    state_region->state.Write(CaptureState);
+
+    if constexpr (lock_stats_enabled) {
+        state_region->lock_stats.Write(CaptureLockStats);
+    }
+}
+
+// -----------------------------------------------------------------------------
+//          Plot Capture
+// -----------------------------------------------------------------------------
+
+static PlotSelection plot_selection = {};
+static uint64_t plot_selection_sequence = 0;
+static bool plot_any_selected = false;
+
+// Picks up selection changes, returns false while nothing is selected or no reader is attached
+static
+bool UpdatePlotSelection(int64_t now)
+{
+    if (!state_region) return false;
+
+    auto sequence = state_region->plot_selection.sequence.load(std::memory_order_acquire);
+    if (sequence != plot_selection_sequence) {
+        if (auto read = state_region->plot_selection.TryRead(plot_selection)) {
+            plot_selection_sequence = read;
+            plot_any_selected = std::ranges::any_of(plot_selection.channels, [](auto& c) { return c.source != PlotSource::None; });
+        }
+    }
+
+    if (!plot_any_selected) return false;
+
+    return now - state_region->reader_heartbeat_ns.load(std::memory_order_relaxed) <= state_reader_timeout_ns;
+}
+
+static
+void PushPlotSample(uint32_t channel, int64_t time_ns, float value)
+{
+    state_region->plot_rings[channel].Push({
+        .time_ns = time_ns,
+        .value = value,
+        .generation = uint32_t(plot_selection_sequence),
+    });
+}
+
+void CapturePlotAxisEvent(const SDL_JoyAxisEvent& event)
+{
+    auto now = StateClockNow();
+    if (!UpdatePlotSelection(now)) return;
+
+    // Event timestamps are on the SDL_GetTicksNS clock, rebase them onto the reader's clock
+    auto time_ns = now - int64_t(SDL_GetTicksNS() - event.timestamp);
+
+    for (uint32_t i = 0; i < state_max_plot_channels; ++i) {
+        auto& channel = plot_selection.channels[i];
+        if (channel.source != PlotSource::JoystickAxis) continue;
+        if (channel.device != event.which || channel.index != event.axis) continue;
+
+        PushPlotSample(i, time_ns, FromSNorm(event.value));
+    }
+}
+
+void CapturePlotSamples()
+{
+    auto now = StateClockNow();
+    if (!UpdatePlotSelection(now)) return;
+
+    // Outputs only change when scripts run, one sample per update
+    for (uint32_t i = 0; i < state_max_plot_channels; ++i) {
+        auto& channel = plot_selection.channels[i];
+        if (channel.source != PlotSource::VirtualJoystickAxis) continue;
+
+        for (auto* script : scripts) {
+            for (auto* vjoy : script->vjoysticks) {
+                if (vjoy->id == channel.device && channel.index < vjoy->num_axes) {
+                    PushPlotSample(i, now, vjoy->axes[channel.index]);
+                }
+            }
+        }
+    }
+}
+
+void ResetStatePublishing()
+{
+    last_publish = 0;
+    state_publish_deadline = std::nullopt;
+
+    plot_selection = {};
+    plot_selection_sequence = 0;
+    plot_any_selected = false;
+}
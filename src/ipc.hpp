@@ -0,0 +1,61 @@
+#pragma once
+
+#include "state.hpp"
+
+#include <string>
+#include <string_view>
+#include <optional>
+
+// -----------------------------------------------------------------------------
+//          Commands
+// -----------------------------------------------------------------------------
+
+// Commands are the only way for GUI clients to modify the engine. They are
+// queued from any thread and executed on the engine thread. Over the command
+// socket each command is a single line of text, e.g. "reload /path/script.lua"
+
+enum class CommandType
+{
+    LoadScript,
+    ReloadScript,
+    UnloadScript,
+    SetAxis,
+    SetButton,
+    ResetVirtualJoystick,
+
+    // No-op, wakes the engine so that state is published to a newly attached client
+    Refresh,
+
+    // Rewrites the trace file with all spans recorded so far
+    WriteTrace,
+};
+
+struct Command
+{
+    CommandType type;
+    std::string path = {};
+    uint64_t target = 0;
+    uint32_t index = 0;
+    float value = 0.f;
+};
+
+std::optional<Command> ParseCommand(std::string_view line);
+std::string FormatCommand(const Command& command);
+
+// -----------------------------------------------------------------------------
+//          Platform
+// -----------------------------------------------------------------------------
+
+// Shared regions are visible to other processes, otherwise the region is private to this process
+StateRegion* CreateStateRegion(bool shared);
+void DestroyStateRegion(StateRegion* region, bool shared);
+StateRegion* OpenStateRegion();
+
+void StartCommandServer();
+void StopCommandServer();
+
+struct CommandConnection;
+
+CommandConnection* ConnectCommandServer();
+void SendCommand(CommandConnection* connection, const Command& command);
+void CloseCommandConnection(CommandConnection* connection);
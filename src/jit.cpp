@@ -0,0 +1,134 @@
+#include "mapper.hpp"
+
+#include <luajit.h>
+
+// -----------------------------------------------------------------------------
+
+// Trace error formats, indexed by the error code of trace abort events
+static constexpr const char* jit_trace_errors[] = {
+#define TREDEF(name, message) message,
+#include <lj_traceerr.h>
+};
+
+// The LuaJIT profiler samples a single VM at a time
+static Script* jit_profiled_script = nullptr;
+
+static
+std::string FormatTraceError(const sol::object& error, const sol::object& info, const sol::table& util)
+{
+    if (error.get_type() != sol::type::number) {
+        return error.is<std::string>() ? error.as<std::string>() : "unknown error";
+    }
+
+    auto code = error.as<size_t>();
+    if (code >= std::size(jit_trace_errors)) return std::format("trace error {}", code);
+
+    // Errors take at most one argument, a number or the offending function
+    std::string argument;
+    if (info.get_type() == sol::type::function) {
+        sol::table func = util["funcinfo"](info);
+        if (auto ffid = func["ffid"].get<std::optional<int>>()) argument = std::format("builtin#{}", *ffid);
+        else                                                    argument = func["loc"].get_or(std::string("?"));
+    } else if (info.get_type() == sol::type::number) {
+        argument = std::to_string(info.as<int64_t>());
+    }
+
+    std::string_view format = jit_trace_errors[code];
+    auto pos = format.find('%');
+    if (pos == std::string_view::npos) return std::string(format);
+    return std::format("{}{}{}", format.substr(0, pos), argument, format.substr(pos + 2));
+}
+
+static
+void RecordTraceAbort(JitStats& jit, std::string location, std::string reason)
+{
+    jit.aborts++;
+    for (auto& site : jit.abort_sites) {
+        if (site.location == location && site.reason == reason) {
+            site.count++;
+            return;
+        }
+    }
+    if (jit.abort_sites.size() < jit_max_abort_sites) {
+        jit.abort_sites.push_back({ std::move(location), std::move(reason), 1 });
+    }
+}
+
+static
+void JitProfileCallback(void* data, lua_State*, int samples, int vmstate)
+{
+    auto& jit = static_cast<Script*>(data)->jit;
+    switch (vmstate) {
+        case 'N': jit.samples_traced += samples; break;
+        case 'I': jit.samples_interpreted += samples; break;
+        case 'G': jit.samples_gc += samples; break;
+        case 'J': jit.samples_compiler += samples; break;
+        default:  jit.samples_host += samples; break;
+    }
+}
+
+// -----------------------------------------------------------------------------
+
+void AttachJitDiagnostics(Script* script)
+{
+    auto& lua = *script->lua;
+    script->jit = {};
+    script->jit_enabled = true;
+
+    // luaopen_jit preloads jit.util, scripts have no require to reach it with
+    sol::table preload = lua.registry()["_PRELOAD"];
+    sol::function open_util = preload["jit.util"];
+    sol::table util = open_util();
+
+    auto handler = [script, util](const std::string& what, sol::object, sol::object func, sol::object pc, sol::object error, sol::object info) {
+        auto& jit = script->jit;
+        if (what == "stop") {
+            jit.traces++;
+        } else if (what == "flush") {
+            jit.flushes++;
+        } else if (what == "abort") {
+            sol::table location = util["funcinfo"](func, pc);
+            RecordTraceAbort(jit, location["loc"].get_or(std::string("?")), FormatTraceError(error, info, util));
+        }
+    };
+
+    lua["jit"]["attach"](handler, "trace");
+}
+
+void ConfigureJit(Script* script, const sol::table& table)
+{
+    auto& lua = *script->lua;
+
+    if (table["off"].get_or(false)) {
+        luaJIT_setmode(lua.lua_state(), 0, LUAJIT_MODE_ENGINE | LUAJIT_MODE_OFF);
+        script->jit_enabled = false;
+    }
+
+    sol::function start = lua["jit"]["opt"]["start"];
+    for (auto param : { "hotloop", "maxtrace" }) {
+        if (auto value = table[param].get<std::optional<int>>()) {
+            start(std::format("{}={}", param, *value));
+        }
+    }
+
+    if (table["profile"].get_or(false)) {
+        if (jit_profiled_script && jit_profiled_script != script) {
+            LogWarn("JIT profiler already attached to [{}], not profiling [{}]", jit_profiled_script->path.string(), script->path.string());
+            return;
+        }
+
+        // 1ms sampling interval
+        luaJIT_profile_start(lua.lua_state(), "i1", JitProfileCallback, script);
+        jit_profiled_script = script;
+        script->jit.profiling = true;
+    }
+}
+
+void StopJitProfile(Script* script)
+{
+    if (jit_profiled_script != script) return;
+
+    luaJIT_profile_stop(script->lua->lua_state());
+    jit_profiled_script = nullptr;
+    script->jit.profiling = false;
+}
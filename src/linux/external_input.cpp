@@ -0,0 +1,352 @@
+#include <mapper.hpp>
+
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+
+#include <memory>
+#include <thread>
+
+#include "socket.hpp"
+
+// -----------------------------------------------------------------------------
+//          External Input Server
+// -----------------------------------------------------------------------------
+
+// Producers are serviced on a dedicated thread. Updates are applied to the SDL
+// virtual joystick and the engine is woken with a joystick update event, SDL
+// then reports the changes as regular joystick events on the engine thread.
+
+struct ExternalProducer
+{
+    int fd = -1;
+    std::string buffer;
+
+    bool registered = false;
+    ExternalDeviceHello hello = {};
+    SDL_JoystickID id = 0;
+    SDL_Joystick* joystick = nullptr;
+
+    // Ring transport only
+    ExternalInputRing* ring = nullptr;
+    int event_fd = -1;
+
+    void Close()
+    {
+        if (joystick) SDL_CloseJoystick(joystick);
+        if (id) SDL_DetachVirtualJoystick(id);
+        if (ring) munmap(ring, sizeof(ExternalInputRing));
+        if (event_fd >= 0) close(event_fd);
+        close(fd);
+    }
+};
+
+struct ExternalInputServer
+{
+    int listen_fd = -1;
+    int stop_fd = -1;
+    std::jthread thread;
+};
+
+static ExternalInputServer external_input_server;
+
+static
+bool RegisterExternalDevice(ExternalProducer& producer, std::span<const int> fds)
+{
+    auto& hello = producer.hello;
+    hello.name[sizeof(hello.name) - 1] = '\0';
+
+    if (hello.magic != external_input_magic || hello.version != external_input_version) {
+        LogWarn("External input [{}] rejected: protocol version mismatch", hello.name);
+        return false;
+    }
+
+    if (hello.num_axes > external_max_axes || hello.num_buttons > external_max_buttons) {
+        LogWarn("External input [{}] rejected: at most {} axes and {} buttons are supported", hello.name, external_max_axes, external_max_buttons);
+        return false;
+    }
+
+    if (hello.transport == ExternalTransport::Ring) {
+        if (fds.size() != 2) {
+            LogWarn("External input [{}] rejected: ring transport requires a memfd and an eventfd", hello.name);
+            return false;
+        }
+
+        struct stat info;
+        if (fstat(fds[0], &info) < 0 || size_t(info.st_size) < sizeof(ExternalInputRing)) {
+            LogWarn("External input [{}] rejected: ring has unexpected size", hello.name);
+            return false;
+        }
+
+        auto memory = mmap(nullptr, sizeof(ExternalInputRing), PROT_READ | PROT_WRITE, MAP_SHARED, fds[0], 0);
+        if (memory == MAP_FAILED) {
+            LogWarn("External input [{}] rejected: failed to map ring: {}", hello.name, std::strerror(errno));
+            return false;
+        }
+
+        producer.ring = static_cast<ExternalInputRing*>(memory);
+        producer.event_fd = fds[1];
+
+        if (producer.ring->magic != external_input_magic || producer.ring->version != external_input_version
+                || producer.ring->capacity != external_ring_capacity) {
+            LogWarn("External input [{}] rejected: ring layout mismatch", hello.name);
+            return false;
+        }
+    } else if (hello.transport != ExternalTransport::Stream) {
+        LogWarn("External input [{}] rejected: unknown transport", hello.name);
+        return false;
+    }
+
+    SDL_VirtualJoystickDesc desc;
+    SDL_INIT_INTERFACE(&desc);
+    desc.type = SDL_JOYSTICK_TYPE_UNKNOWN;
+    desc.naxes = hello.num_axes;
+    desc.nbuttons = hello.num_buttons;
+    desc.vendor_id = hello.vendor_id;
+    desc.product_id = hello.product_id;
+    desc.name = hello.name;
+
+    producer.id = SDL_AttachVirtualJoystick(&desc);
+    if (!producer.id) {
+        LogWarn("External input [{}] rejected: {}", hello.name, SDL_GetError());
+        return false;
+    }
+
+    producer.joystick = SDL_OpenJoystick(producer.id);
+    if (!producer.joystick) {
+        LogWarn("External input [{}] rejected: {}", hello.name, SDL_GetError());
+        return false;
+    }
+
+    producer.registered = true;
+    Log("External input registered: {} ({})", hello.name, hello.transport == ExternalTransport::Ring ? "ring" : "stream");
+
+    return true;
+}
+
+static
+void ApplyExternalEvent(ExternalProducer& producer, const ExternalInputEvent& event)
+{
+    switch (event.type) {
+        case ExternalEventType::Axis:
+            if (event.index >= producer.hello.num_axes) break;
+            SDL_SetJoystickVirtualAxis(producer.joystick, event.index, Sint16(std::clamp(event.value, -1.f, 1.f) * 32767.f));
+            break;
+        case ExternalEventType::Button:
+            if (event.index >= producer.hello.num_buttons) break;
+            SDL_SetJoystickVirtualButton(producer.joystick, event.index, event.value != 0.f);
+            break;
+    }
+}
+
+// Returns true if any events were applied
+static
+bool DrainExternalRing(ExternalProducer& producer)
+{
+    uint64_t value;
+    [[maybe_unused]] auto res = ::read(producer.event_fd, &value, sizeof(value));
+
+    auto ring = producer.ring;
+    auto head = ring->head.load(std::memory_order_relaxed);
+    auto tail = ring->tail.load(std::memory_order_acquire);
+
+    // A producer that overran the ring has lost events, skip to the oldest that are still intact
+    if (tail - head > external_ring_capacity) {
+        head = tail - external_ring_capacity;
+    }
+
+    bool any = head != tail;
+    for (; head != tail; ++head) {
+        ApplyExternalEvent(producer, ring->events[head % external_ring_capacity]);
+    }
+    ring->head.store(head, std::memory_order_release);
+
+    return any;
+}
+
+// Returns false if the producer should be dropped
+static
+bool ReadExternalProducer(ExternalProducer& producer, bool& updated)
+{
+    std::array<char, 4096> data;
+    alignas(cmsghdr) std::array<char, CMSG_SPACE(sizeof(int) * 2)> control;
+
+    iovec iov = { .iov_base = data.data(), .iov_len = data.size() };
+    msghdr message = {};
+    message.msg_iov = &iov;
+    message.msg_iovlen = 1;
+    message.msg_control = control.data();
+    message.msg_controllen = control.size();
+
+    auto bytes = ::recvmsg(producer.fd, &message, MSG_DONTWAIT | MSG_CMSG_CLOEXEC);
+    if (bytes == 0) return false;
+    if (bytes < 0) return errno == EAGAIN || errno == EINTR;
+
+    std::vector<int> fds;
+    for (auto cmsg = CMSG_FIRSTHDR(&message); cmsg; cmsg = CMSG_NXTHDR(&message, cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET || cmsg->cmsg_type != SCM_RIGHTS) continue;
+        auto count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+        auto first = reinterpret_cast<const int*>(CMSG_DATA(cmsg));
+        fds.insert(fds.end(), first, first + count);
+    }
+    // The memfd stays mapped after being closed, the eventfd is kept by the producer
+    Defer close_fds = [&] {
+        for (auto fd : fds) {
+            if (fd != producer.event_fd) close(fd);
+        }
+    };
+
+    producer.buffer.append(data.data(), size_t(bytes));
+
+    // File descriptors are only accepted alongside a complete hello, which must be sent in a single message
+    if (!producer.registered) {
+        if (producer.buffer.size() < sizeof(ExternalDeviceHello)) return fds.empty();
+        std::memcpy(&producer.hello, producer.buffer.data(), sizeof(ExternalDeviceHello));
+        producer.buffer.erase(0, sizeof(ExternalDeviceHello));
+        if (!RegisterExternalDevice(producer, fds)) return false;
+    } else if (!fds.empty()) {
+        return false;
+    }
+
+    // Only stream producers send events over the socket
+    if (producer.ring) {
+        return producer.buffer.empty();
+    }
+
+    size_t count = producer.buffer.size() / sizeof(ExternalInputEvent);
+    for (size_t i = 0; i < count; ++i) {
+        ExternalInputEvent event;
+        std::memcpy(&event, producer.buffer.data() + i * sizeof(ExternalInputEvent), sizeof(event));
+        ApplyExternalEvent(producer, event);
+    }
+    producer.buffer.erase(0, count * sizeof(ExternalInputEvent));
+    updated |= count > 0;
+
+    return true;
+}
+
+static
+void RunExternalInputServer(std::stop_token stop)
+{
+    std::vector<std::unique_ptr<ExternalProducer>> producers;
+    std::vector<pollfd> fds;
+
+    while (!stop.stop_requested()) {
+        // Each producer polls its socket, and its eventfd when using the ring transport
+        fds.clear();
+        fds.push_back({ .fd = external_input_server.stop_fd, .events = POLLIN });
+        fds.push_back({ .fd = external_input_server.listen_fd, .events = POLLIN });
+        for (auto& producer : producers) {
+            fds.push_back({ .fd = producer->fd, .events = POLLIN });
+            fds.push_back({ .fd = producer->event_fd, .events = POLLIN });
+        }
+
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            LogWarn("External input server poll failed: {}", std::strerror(errno));
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) break;
+
+        MAPPER_TRACE_SPAN("External Inputs");
+
+        bool updated = false;
+
+        // Service existing producers before accepting, so indices into `fds` stay valid
+        for (size_t i = producers.size(); i-- > 0;) {
+            auto& producer = *producers[i];
+            auto& socket_pfd = fds[2 + i * 2];
+            auto& event_pfd = fds[3 + i * 2];
+
+            bool keep = true;
+            if (socket_pfd.revents & (POLLIN | POLLHUP | POLLERR)) {
+                keep = ReadExternalProducer(producer, updated);
+            }
+            if (keep && producer.ring && (event_pfd.revents & POLLIN)) {
+                updated |= DrainExternalRing(producer);
+            }
+
+            if (!keep) {
+                if (producer.registered) Log("External input removed: {}", producer.hello.name);
+                producer.Close();
+                producers.erase(producers.begin() + ptrdiff_t(i));
+            }
+        }
+
+        if (updated) {
+            PushJoystickUpdateEvent();
+        }
+
+        if (fds[1].revents & POLLIN) {
+            int fd = accept4(external_input_server.listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd >= 0) {
+                auto producer = std::make_unique<ExternalProducer>();
+                producer->fd = fd;
+                producers.emplace_back(std::move(producer));
+            }
+        }
+    }
+
+    for (auto& producer : producers) {
+        producer->Close();
+    }
+}
+
+void StartExternalInputServer()
+{
+    EnsureUserSocketDir();
+    auto path = UserSocketPath("mapper-inputs.sock");
+
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        Error("External input socket path too long: {}", path);
+    }
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        Error("Failed to create external input socket: {}", std::strerror(errno));
+    }
+
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(fd, 8) < 0) {
+        auto error = errno;
+        close(fd);
+        Error("Failed to listen on external input socket [{}]: {}", path, std::strerror(error));
+    }
+    chmod(path.c_str(), 0600);
+
+    external_input_server.listen_fd = fd;
+    external_input_server.stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    external_input_server.thread = std::jthread([](std::stop_token stop) {
+        std::stop_callback wake{ stop, [] {
+            uint64_t value = 1;
+            [[maybe_unused]] auto res = ::write(external_input_server.stop_fd, &value, sizeof(value));
+        }};
+        MAPPER_TRACE_THREAD("External Inputs");
+        RunExternalInputServer(stop);
+    });
+
+    Log("Listening for external inputs on: {}", path);
+}
+
+void StopExternalInputServer()
+{
+    if (external_input_server.listen_fd < 0) return;
+
+    external_input_server.thread = {};
+    close(external_input_server.listen_fd);
+    close(external_input_server.stop_fd);
+    external_input_server.listen_fd = -1;
+    unlink(UserSocketPath("mapper-inputs.sock").c_str());
+}
@@ -0,0 +1,213 @@
+#include <mapper.hpp>
+
+#include <linux/input.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+#include <array>
+#include <span>
+#include <thread>
+
+struct InputDevice_EvDev : InputDevice
+{
+    int fd = -1;
+    int stop_fd = -1;
+    bool recording = false;
+
+    // Only accessed from the reader thread, folded into `pending` on SYN_REPORT
+    InputDeviceState frame;
+
+    std::jthread thread;
+};
+
+// -----------------------------------------------------------------------------
+
+static
+void FlushFrame(InputDevice_EvDev* device)
+{
+    auto& frame = device->frame;
+    {
+        std::scoped_lock _{ device->mutex };
+        auto& pending = device->pending;
+        pending.keys = frame.keys;
+        pending.pressed |= frame.pressed;
+        pending.rel_x  += frame.rel_x;
+        pending.rel_y  += frame.rel_y;
+        pending.wheel  += frame.wheel;
+        pending.hwheel += frame.hwheel;
+    }
+    frame.pressed.reset();
+    frame.rel_x = frame.rel_y = frame.wheel = frame.hwheel = 0;
+
+    // Wake the engine once per frame, no matter how many reports arrive before it runs
+    if (!device->wake_pending.exchange(true)) {
+        PushJoystickUpdateEvent();
+    }
+}
+
+static
+void HandleEvent(InputDevice_EvDev* device, const input_event& event)
+{
+    auto& frame = device->frame;
+    switch (event.type) {
+        case EV_KEY:
+            if (event.code > max_key_code) break;
+            frame.keys[event.code] = event.value != 0;
+            if (event.value == 1) frame.pressed[event.code] = true;
+            break;
+        case EV_REL:
+            switch (event.code) {
+                case REL_X:      frame.rel_x  += event.value; break;
+                case REL_Y:      frame.rel_y  += event.value; break;
+                case REL_WHEEL:  frame.wheel  += event.value; break;
+                case REL_HWHEEL: frame.hwheel += event.value; break;
+            }
+            break;
+        case EV_SYN:
+            if (event.code == SYN_REPORT) FlushFrame(device);
+            break;
+    }
+}
+
+// Returns false once the device is being destroyed
+static
+bool WaitReadable(InputDevice_EvDev* device)
+{
+    std::array fds {
+        pollfd { .fd = device->fd,      .events = POLLIN },
+        pollfd { .fd = device->stop_fd, .events = POLLIN },
+    };
+    while (poll(fds.data(), fds.size(), -1) < 0) {
+        if (errno != EINTR) return false;
+    }
+    return !(fds[1].revents & POLLIN);
+}
+
+// Returns true if the device is destroyed before the timeout elapses
+static
+bool WaitForStop(InputDevice_EvDev* device, int timeout_ms)
+{
+    pollfd fd { .fd = device->stop_fd, .events = POLLIN };
+    while (poll(&fd, 1, timeout_ms) < 0) {
+        if (errno != EINTR) return true;
+    }
+    return fd.revents & POLLIN;
+}
+
+static
+void ReadDevice(InputDevice_EvDev* device)
+{
+    std::array<input_event, 64> events;
+
+    while (WaitReadable(device)) {
+        auto bytes = ::read(device->fd, events.data(), sizeof(events));
+        if (bytes < 0) {
+            if (errno == EAGAIN || errno == EINTR) continue;
+            LogWarn("Input device [{}] read failed: {}", device->name, std::strerror(errno));
+            return;
+        }
+        if (bytes == 0) return;
+
+        MAPPER_TRACE_SPAN("Input Device Events");
+
+        auto count = size_t(bytes) / sizeof(input_event);
+        device->events_received += count;
+        for (auto& event : std::span(events.data(), count)) {
+            HandleEvent(device, event);
+        }
+    }
+}
+
+// Replays a file of raw input_event records with their original timing
+static
+void ReplayRecording(InputDevice_EvDev* device)
+{
+    using namespace std::chrono;
+
+    do {
+        lseek(device->fd, 0, SEEK_SET);
+
+        input_event event;
+        std::optional<microseconds> first_time;
+        auto start = steady_clock::now();
+
+        while (::read(device->fd, &event, sizeof(event)) == ssize_t(sizeof(event))) {
+            auto time = seconds(event.input_event_sec) + microseconds(event.input_event_usec);
+            if (!first_time) first_time = time;
+
+            auto due = start + (time - *first_time);
+            auto remaining = ceil<milliseconds>(due - steady_clock::now()).count();
+            if (remaining > 0 && WaitForStop(device, int(remaining))) return;
+
+            ++device->events_received;
+            HandleEvent(device, event);
+        }
+    } while (device->loop && !WaitForStop(device, 0));
+}
+
+// -----------------------------------------------------------------------------
+
+InputDevice* OpenInputDevice(const InputDeviceDesc& desc)
+{
+    int fd = open(desc.path.c_str(), O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        Error("Failed to open input device [{}]: {}", desc.path, std::strerror(errno));
+    }
+
+    struct stat info;
+    fstat(fd, &info);
+    bool recording = S_ISREG(info.st_mode);
+
+    std::string name = std::filesystem::path(desc.path).filename().string();
+    if (!recording) {
+        std::array<char, 256> buffer = {};
+        if (ioctl(fd, EVIOCGNAME(buffer.size() - 1), buffer.data()) >= 0) {
+            name = buffer.data();
+        }
+
+        if (desc.grab && ioctl(fd, EVIOCGRAB, 1) < 0) {
+            auto error = errno;
+            close(fd);
+            Error("Failed to grab input device [{}]: {}", desc.path, std::strerror(error));
+        }
+    }
+
+    auto device = new InputDevice_EvDev{{desc}};
+    device->name = std::move(name);
+    device->fd = fd;
+    device->stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    device->recording = recording;
+
+    Log("Input device opened: {}{}", device->name, recording ? " (recording)" : desc.grab ? " (grabbed)" : "");
+
+    device->thread = std::jthread([device](std::stop_token stop) {
+        std::stop_callback wake{ stop, [device] {
+            uint64_t value = 1;
+            [[maybe_unused]] auto res = ::write(device->stop_fd, &value, sizeof(value));
+        }};
+        MAPPER_TRACE_THREAD("Input Device");
+        if (device->recording) ReplayRecording(device);
+        else                   ReadDevice(device);
+    });
+
+    return device;
+}
+
+void InputDevice::Destroy()
+{
+    auto self = static_cast<InputDevice_EvDev*>(this);
+
+    self->thread = {};
+
+    // Closing the device also releases any grab
+    close(self->fd);
+    close(self->stop_fd);
+
+    delete self;
+}
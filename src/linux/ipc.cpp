@@ -0,0 +1,302 @@
+#include <mapper.hpp>
+
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+
+#include <thread>
+
+#include "socket.hpp"
+
+// -----------------------------------------------------------------------------
+//          State Region
+// -----------------------------------------------------------------------------
+
+static
+std::string StateRegionName()
+{
+    return std::format("/mapper-state-{}", getuid());
+}
+
+StateRegion* CreateStateRegion(bool shared)
+{
+    if (!shared) {
+        auto region = new StateRegion{};
+        region->magic = state_region_magic;
+        region->version = state_region_version;
+        region->size = sizeof(StateRegion);
+        return region;
+    }
+
+    auto name = StateRegionName();
+    int fd = shm_open(name.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        Error("Failed to create state region [{}]: {}", name, std::strerror(errno));
+    }
+    Defer _ = [&] { close(fd); };
+
+    if (ftruncate(fd, sizeof(StateRegion)) < 0) {
+        Error("Failed to size state region [{}]: {}", name, std::strerror(errno));
+    }
+
+    auto memory = mmap(nullptr, sizeof(StateRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED) {
+        Error("Failed to map state region [{}]: {}", name, std::strerror(errno));
+    }
+
+    auto region = new (memory) StateRegion{};
+    region->magic = state_region_magic;
+    region->version = state_region_version;
+    region->size = sizeof(StateRegion);
+
+    return region;
+}
+
+void DestroyStateRegion(StateRegion* region, bool shared)
+{
+    if (!shared) {
+        delete region;
+        return;
+    }
+
+    // Attached readers keep their mapping, the name is freed for the next daemon
+    munmap(region, sizeof(StateRegion));
+    shm_unlink(StateRegionName().c_str());
+}
+
+StateRegion* OpenStateRegion()
+{
+    auto name = StateRegionName();
+    int fd = shm_open(name.c_str(), O_RDWR | O_CLOEXEC, 0);
+    if (fd < 0) {
+        Error("Failed to open state region [{}], is the daemon running? {}", name, std::strerror(errno));
+    }
+    Defer _ = [&] { close(fd); };
+
+    struct stat info;
+    if (fstat(fd, &info) < 0 || size_t(info.st_size) < sizeof(StateRegion)) {
+        Error("State region [{}] has unexpected size", name);
+    }
+
+    auto memory = mmap(nullptr, sizeof(StateRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED) {
+        Error("Failed to map state region [{}]: {}", name, std::strerror(errno));
+    }
+
+    auto region = static_cast<StateRegion*>(memory);
+    if (region->magic != state_region_magic || region->version != state_region_version || region->size != sizeof(StateRegion)) {
+        Error("State region [{}] version mismatch, daemon and GUI must be the same build", name);
+    }
+
+    return region;
+}
+
+// -----------------------------------------------------------------------------
+//          Command Server
+// -----------------------------------------------------------------------------
+
+static
+std::string CommandSocketPath()
+{
+    return UserSocketPath("mapper.sock");
+}
+
+struct CommandServer
+{
+    int listen_fd = -1;
+    int stop_fd = -1;
+    std::jthread thread;
+};
+
+static CommandServer command_server;
+
+// Longest partial line buffered per client, clients that exceed it are dropped
+constexpr size_t command_max_line = 16 * 1024;
+
+struct CommandClient
+{
+    int fd;
+    std::string buffer;
+};
+
+static
+void HandleCommandLines(CommandClient& client)
+{
+    size_t end;
+    while ((end = client.buffer.find('\n')) != std::string::npos) {
+        auto line = client.buffer.substr(0, end);
+        client.buffer.erase(0, end + 1);
+
+        auto command = ParseCommand(line);
+        std::string_view reply = command ? "ok\n" : "error: invalid command\n";
+        if (command) QueueCommand(std::move(*command));
+        [[maybe_unused]] auto res = ::send(client.fd, reply.data(), reply.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+    }
+}
+
+static
+void RunCommandServer(std::stop_token stop)
+{
+    std::vector<CommandClient> clients;
+    std::vector<pollfd> fds;
+    std::array<char, 4096> buffer;
+
+    while (!stop.stop_requested()) {
+        fds.clear();
+        fds.push_back({ .fd = command_server.stop_fd, .events = POLLIN });
+        fds.push_back({ .fd = command_server.listen_fd, .events = POLLIN });
+        for (auto& client : clients) {
+            fds.push_back({ .fd = client.fd, .events = POLLIN });
+        }
+
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            LogWarn("Command server poll failed: {}", std::strerror(errno));
+            break;
+        }
+
+        if (fds[0].revents & POLLIN) break;
+
+        // Service existing clients before accepting, so indices into `fds` stay valid
+        for (size_t i = clients.size(); i-- > 0;) {
+            auto& pfd = fds[i + 2];
+            if (!(pfd.revents & (POLLIN | POLLHUP | POLLERR))) continue;
+
+            bool drop = false;
+            auto bytes = ::recv(pfd.fd, buffer.data(), buffer.size(), MSG_DONTWAIT);
+            if (bytes > 0) {
+                clients[i].buffer.append(buffer.data(), size_t(bytes));
+                HandleCommandLines(clients[i]);
+                if (clients[i].buffer.size() > command_max_line) {
+                    LogWarn("Dropping command client, line exceeds {} bytes", command_max_line);
+                    std::string_view reply = "error: command too long\n";
+                    [[maybe_unused]] auto res = ::send(clients[i].fd, reply.data(), reply.size(), MSG_NOSIGNAL | MSG_DONTWAIT);
+                    drop = true;
+                }
+            } else if (bytes == 0 || (errno != EAGAIN && errno != EINTR)) {
+                drop = true;
+            }
+
+            if (drop) {
+                close(clients[i].fd);
+                clients.erase(clients.begin() + ptrdiff_t(i));
+            }
+        }
+
+        if (fds[1].revents & POLLIN) {
+            int fd = accept4(command_server.listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd >= 0) clients.push_back({ .fd = fd });
+        }
+    }
+
+    for (auto& client : clients) {
+        close(client.fd);
+    }
+}
+
+void StartCommandServer()
+{
+    EnsureUserSocketDir();
+    auto path = CommandSocketPath();
+
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        Error("Command socket path too long: {}", path);
+    }
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) {
+        Error("Failed to create command socket: {}", std::strerror(errno));
+    }
+
+    unlink(path.c_str());
+    if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(fd, 8) < 0) {
+        auto error = errno;
+        close(fd);
+        Error("Failed to listen on command socket [{}]: {}", path, std::strerror(error));
+    }
+    chmod(path.c_str(), 0600);
+
+    command_server.listen_fd = fd;
+    command_server.stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    command_server.thread = std::jthread([](std::stop_token stop) {
+        std::stop_callback wake{ stop, [] {
+            uint64_t value = 1;
+            [[maybe_unused]] auto res = ::write(command_server.stop_fd, &value, sizeof(value));
+        }};
+        MAPPER_TRACE_THREAD("Command Server");
+        RunCommandServer(stop);
+    });
+
+    Log("Listening for commands on: {}", path);
+}
+
+void StopCommandServer()
+{
+    if (command_server.listen_fd < 0) return;
+
+    command_server.thread = {};
+    close(command_server.listen_fd);
+    close(command_server.stop_fd);
+    command_server.listen_fd = -1;
+    unlink(CommandSocketPath().c_str());
+}
+
+// -----------------------------------------------------------------------------
+//          Command Client
+// -----------------------------------------------------------------------------
+
+struct CommandConnection
+{
+    int fd;
+    std::mutex mutex;
+};
+
+CommandConnection* ConnectCommandServer()
+{
+    auto path = CommandSocketPath();
+
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        auto error = errno;
+        if (fd >= 0) close(fd);
+        Error("Failed to connect to command socket [{}]: {}", path, std::strerror(error));
+    }
+
+    return new CommandConnection{ .fd = fd };
+}
+
+void SendCommand(CommandConnection* connection, const Command& command)
+{
+    auto line = FormatCommand(command);
+
+    std::scoped_lock _{ connection->mutex };
+
+    // Replies are informational only, drain them so the daemon never blocks on a full socket
+    std::array<char, 256> replies;
+    while (::recv(connection->fd, replies.data(), replies.size(), MSG_DONTWAIT) > 0);
+
+    if (::send(connection->fd, line.data(), line.size(), MSG_NOSIGNAL) != ssize_t(line.size())) {
+        LogWarn("Failed to send command: {}", std::strerror(errno));
+    }
+}
+
+void CloseCommandConnection(CommandConnection* connection)
+{
+    close(connection->fd);
+    delete connection;
+}
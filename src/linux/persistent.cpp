@@ -0,0 +1,35 @@
+#include <mapper.hpp>
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+PersistentFile* MapPersistentFile(const std::filesystem::path& path)
+{
+    int fd = open(path.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        Error("Failed to open persistent state [{}]: {}", path.string(), std::strerror(errno));
+    }
+    Defer _ = [&] { close(fd); };
+
+    if (ftruncate(fd, sizeof(PersistentFile)) < 0) {
+        Error("Failed to size persistent state [{}]: {}", path.string(), std::strerror(errno));
+    }
+
+    auto memory = mmap(nullptr, sizeof(PersistentFile), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED) {
+        Error("Failed to map persistent state [{}]: {}", path.string(), std::strerror(errno));
+    }
+
+    return static_cast<PersistentFile*>(memory);
+}
+
+void UnmapPersistentFile(PersistentFile* file)
+{
+    // Writes already live in the page cache and survive a crash of this process,
+    // start writeback so that they also survive losing the machine soon after
+    msync(file, sizeof(PersistentFile), MS_ASYNC);
+    munmap(file, sizeof(PersistentFile));
+}
@@ -0,0 +1,38 @@
+#include <mapper.hpp>
+
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+
+#include "socket.hpp"
+
+static
+std::string UserSocketFallbackDir()
+{
+    return std::format("/tmp/mapper-{}", getuid());
+}
+
+std::string UserSocketPath(std::string_view name)
+{
+    if (auto runtime_dir = std::getenv("XDG_RUNTIME_DIR")) {
+        return std::format("{}/{}", runtime_dir, name);
+    }
+    return std::format("{}/{}", UserSocketFallbackDir(), name);
+}
+
+void EnsureUserSocketDir()
+{
+    if (std::getenv("XDG_RUNTIME_DIR")) return;
+
+    auto dir = UserSocketFallbackDir();
+    if (mkdir(dir.c_str(), 0700) < 0 && errno != EEXIST) {
+        Error("Failed to create socket directory [{}]: {}", dir, std::strerror(errno));
+    }
+
+    struct stat info;
+    if (lstat(dir.c_str(), &info) < 0 || !S_ISDIR(info.st_mode) || info.st_uid != getuid() || (info.st_mode & 0077)) {
+        Error("Socket directory [{}] must be a directory private to this user", dir);
+    }
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+// -----------------------------------------------------------------------------
+//          User Sockets
+// -----------------------------------------------------------------------------
+
+// Local sockets live in $XDG_RUNTIME_DIR, or without it in /tmp/mapper-<uid>.
+// The fallback directory is created private to this user and verified before
+// a server binds in it, so no other user can reach a socket, not even between
+// bind and chmod, or plant anything at its path.
+
+std::string UserSocketPath(std::string_view name);
+
+// Servers call this before binding, creates and verifies the fallback directory if it is in use
+void EnsureUserSocketDir();
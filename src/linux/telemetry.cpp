@@ -0,0 +1,39 @@
+#include <mapper.hpp>
+
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+TelemetryRegion* OpenTelemetry(const std::filesystem::path& path)
+{
+    int fd = open(path.c_str(), O_CREAT | O_RDWR | O_CLOEXEC, 0644);
+    if (fd < 0) {
+        Error("Failed to open telemetry file [{}]: {}", path.string(), std::strerror(errno));
+    }
+    Defer _ = [&] { close(fd); };
+
+    if (ftruncate(fd, sizeof(TelemetryRegion)) < 0) {
+        Error("Failed to size telemetry file [{}]: {}", path.string(), std::strerror(errno));
+    }
+
+    auto memory = mmap(nullptr, sizeof(TelemetryRegion), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (memory == MAP_FAILED) {
+        Error("Failed to map telemetry file [{}]: {}", path.string(), std::strerror(errno));
+    }
+
+    auto region = new (memory) TelemetryRegion{};
+    region->magic = telemetry_magic;
+    region->version = telemetry_version;
+    region->size = sizeof(TelemetryRegion);
+
+    Log("Writing telemetry to: {}", path.string());
+
+    return region;
+}
+
+void CloseTelemetry(TelemetryRegion* region)
+{
+    munmap(region, sizeof(TelemetryRegion));
+}
@@ -0,0 +1,232 @@
+#include <vinput.hpp>
+
+#include <common.hpp>
+
+#include <linux/uinput.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+
+#include <array>
+#include <span>
+#include <vector>
+
+constexpr std::array mouse_button_codes {
+    BTN_LEFT,
+    BTN_RIGHT,
+    BTN_MIDDLE,
+    BTN_SIDE,
+    BTN_EXTRA,
+};
+
+static_assert(mouse_button_codes.size() == max_mouse_button_count);
+
+// -----------------------------------------------------------------------------
+
+struct UInputDevice
+{
+    int fd = -1;
+    std::string name;
+
+    void Open(const std::string& _name)
+    {
+        name = _name;
+        if (null_output) return;
+        fd = open("/dev/uinput", O_RDWR | O_NONBLOCK | O_CLOEXEC);
+        if (fd < 0) {
+            Error("Failed to open /dev/uinput: {}", std::strerror(errno));
+        }
+    }
+
+    void Ioctl(unsigned long request, auto arg, const char* step)
+    {
+        if (fd < 0 || ioctl(fd, request, arg) >= 0) return;
+        auto error = errno;
+        close(fd);
+        fd = -1;
+        Error("Failed to create virtual device [{}] ({}): {}", name, step, std::strerror(error));
+    }
+
+    void Create(uint16_t vendor_id, uint16_t product_id, uint16_t version)
+    {
+        uinput_setup setup = {};
+        setup.id.bustype = BUS_VIRTUAL;
+        setup.id.vendor = vendor_id;
+        setup.id.product = product_id;
+        setup.id.version = version;
+        std::strncpy(setup.name, name.c_str(), UINPUT_MAX_NAME_SIZE - 1);
+
+        Ioctl(UI_DEV_SETUP, &setup, "UI_DEV_SETUP");
+        Ioctl(UI_DEV_CREATE, 0, "UI_DEV_CREATE");
+    }
+
+    void Destroy()
+    {
+        if (fd < 0) return;
+        ioctl(fd, UI_DEV_DESTROY);
+        close(fd);
+    }
+
+    // Submits a full frame of events with a single write
+    void Write(std::span<const input_event> events)
+    {
+        if (fd < 0) return;
+        auto size = events.size_bytes();
+        ssize_t written;
+        do {
+            written = ::write(fd, events.data(), size);
+        } while (written < 0 && errno == EINTR);
+
+        if (written != ssize_t(size)) {
+            LogWarn("Failed to write events to virtual device [{}]: {}", name, written < 0 ? std::strerror(errno) : "short write");
+        }
+    }
+};
+
+struct EventBuffer
+{
+    std::vector<input_event> events;
+
+    void Push(uint16_t type, uint16_t code, int32_t value)
+    {
+        auto& event = events.emplace_back();
+        event = {};
+        event.type = type;
+        event.code = code;
+        event.value = value;
+    }
+};
+
+// -----------------------------------------------------------------------------
+//          Virtual Mouse
+// -----------------------------------------------------------------------------
+
+struct VirtualMouse_EvDev : VirtualMouse
+{
+    UInputDevice device;
+    std::array<bool, max_mouse_button_count> last_buttons;
+    EventBuffer buffer;
+};
+
+VirtualMouse* CreateVirtualMouse(const VirtualMouseDesc& desc)
+{
+    UInputDevice device;
+    device.Open(desc.name);
+
+    device.Ioctl(UI_SET_EVBIT, EV_REL, "EV_REL");
+    for (auto code : { REL_X, REL_Y, REL_WHEEL, REL_HWHEEL }) {
+        device.Ioctl(UI_SET_RELBIT, code, "UI_SET_RELBIT");
+    }
+
+    device.Ioctl(UI_SET_EVBIT, EV_KEY, "EV_KEY");
+    for (auto code : mouse_button_codes) {
+        device.Ioctl(UI_SET_KEYBIT, code, "UI_SET_KEYBIT");
+    }
+
+    device.Create(desc.vendor_id, desc.product_id, desc.version);
+
+    auto mouse = new VirtualMouse_EvDev{{desc}};
+    mouse->device = std::move(device);
+    mouse->buffer.events.reserve(16);
+
+    return mouse;
+}
+
+void VirtualMouse::Destroy()
+{
+    auto self = static_cast<VirtualMouse_EvDev*>(this);
+
+    self->device.Destroy();
+
+    delete self;
+}
+
+bool VirtualMouse::Update()
+{
+    auto self = static_cast<VirtualMouse_EvDev*>(this);
+
+    self->dirty = false;
+
+    auto& buffer = self->buffer;
+    buffer.events.clear();
+
+    if (self->delta_x)      buffer.Push(EV_REL, REL_X,      self->delta_x);
+    if (self->delta_y)      buffer.Push(EV_REL, REL_Y,      self->delta_y);
+    if (self->delta_wheel)  buffer.Push(EV_REL, REL_WHEEL,  self->delta_wheel);
+    if (self->delta_hwheel) buffer.Push(EV_REL, REL_HWHEEL, self->delta_hwheel);
+    self->delta_x = self->delta_y = self->delta_wheel = self->delta_hwheel = 0;
+
+    for (uint32_t i = 0; i < max_mouse_button_count; ++i) {
+        if (self->buttons[i] == self->last_buttons[i]) continue;
+        self->last_buttons[i] = self->buttons[i];
+        buffer.Push(EV_KEY, mouse_button_codes[i], self->buttons[i]);
+    }
+
+    if (buffer.events.empty()) return false;
+
+    buffer.Push(EV_SYN, SYN_REPORT, 0);
+    self->device.Write(buffer.events);
+
+    return true;
+}
+
+// -----------------------------------------------------------------------------
+//          Virtual Keyboard
+// -----------------------------------------------------------------------------
+
+struct VirtualKeyboard_EvDev : VirtualKeyboard
+{
+    UInputDevice device;
+    EventBuffer buffer;
+};
+
+VirtualKeyboard* CreateVirtualKeyboard(const VirtualKeyboardDesc& desc)
+{
+    UInputDevice device;
+    device.Open(desc.name);
+
+    device.Ioctl(UI_SET_EVBIT, EV_KEY, "EV_KEY");
+    for (uint32_t code = 0; code <= max_key_code; ++code) {
+        if (IsKeyboardKeyCode(code)) device.Ioctl(UI_SET_KEYBIT, int(code), "UI_SET_KEYBIT");
+    }
+
+    device.Create(desc.vendor_id, desc.product_id, desc.version);
+
+    auto keyboard = new VirtualKeyboard_EvDev{{desc}};
+    keyboard->device = std::move(device);
+    keyboard->buffer.events.reserve(16);
+
+    return keyboard;
+}
+
+void VirtualKeyboard::Destroy()
+{
+    auto self = static_cast<VirtualKeyboard_EvDev*>(this);
+
+    self->device.Destroy();
+
+    delete self;
+}
+
+bool VirtualKeyboard::Update()
+{
+    auto self = static_cast<VirtualKeyboard_EvDev*>(this);
+
+    self->dirty = false;
+
+    auto changed = self->keys ^ self->last_keys;
+    if (changed.none()) return false;
+    self->last_keys = self->keys;
+
+    auto& buffer = self->buffer;
+    buffer.events.clear();
+    for (uint32_t code = 0; code <= max_key_code; ++code) {
+        if (changed[code]) buffer.Push(EV_KEY, uint16_t(code), self->keys[code]);
+    }
+    buffer.Push(EV_SYN, SYN_REPORT, 0);
+    self->device.Write(buffer.events);
+
+    return true;
+}
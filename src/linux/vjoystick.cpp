@@ -1,11 +1,23 @@
 #include <vjoystick.hpp>
 
-#include <libevdev/libevdev-uinput.h>
-#include <libevdev/libevdev.h>
+#include <common.hpp>
+#include <trace.hpp>
+
+#include <linux/uinput.h>
+#include <sys/eventfd.h>
+#include <sys/ioctl.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
 
 #include <array>
 #include <vector>
 #include <ranges>
+#include <span>
+#include <thread>
 
 constexpr std::array axis_codes {
     ABS_X,
@@ -60,45 +72,331 @@ constexpr std::array button_codes {
     BTN_9,
 };
 
+constexpr uint32_t max_ff_effects = 16;
+
 struct VirtualJoystick_EvDev : VirtualJoystick
 {
-    libevdev* dev = {};
-    libevdev_uinput* uidev = {};
+    int fd = -1;
 
-    std::array<float, max_axis_count> last_axes;
+    // Last values written to the device, compared in the quantized output space
+    std::array<int16_t, max_axis_count> last_axes;
     std::array<bool, max_button_count> last_buttons;
+
+    // Only accessed from the force feedback thread
+    std::array<ff_effect, max_ff_effects> ff_effects;
+    std::array<bool, max_ff_effects> ff_effect_valid;
+    float ff_gain = 1.f;
 };
 
+static
+int16_t QuantizeAxis(float value)
+{
+    return int16_t(value * axis_max_value);
+}
+
+// -----------------------------------------------------------------------------
+//          Force Feedback
+// -----------------------------------------------------------------------------
+
+// Force feedback requests arrive on the uinput fd and must be acknowledged
+// promptly, so they are serviced on a dedicated thread that never touches the
+// engine lock.
+
+struct ForceFeedbackThread
+{
+    std::mutex mutex;
+    std::vector<VirtualJoystick_EvDev*> devices;
+    int wake_fd = -1;
+    std::jthread thread;
+};
+
+static ForceFeedbackThread ff_thread;
+
+static
+void HandleForceFeedbackEvent(VirtualJoystick_EvDev* vjoy, const input_event& event)
+{
+    if (event.type == EV_UINPUT && event.code == UI_FF_UPLOAD) {
+        uinput_ff_upload upload = {};
+        upload.request_id = uint32_t(event.value);
+        if (ioctl(vjoy->fd, UI_BEGIN_FF_UPLOAD, &upload) < 0) return;
+        if (upload.effect.id >= 0 && upload.effect.id < int16_t(max_ff_effects)) {
+            vjoy->ff_effects[upload.effect.id] = upload.effect;
+            vjoy->ff_effect_valid[upload.effect.id] = true;
+            ++vjoy->ff_stats.uploads;
+            upload.retval = 0;
+        } else {
+            upload.retval = -EINVAL;
+        }
+        ioctl(vjoy->fd, UI_END_FF_UPLOAD, &upload);
+    } else if (event.type == EV_UINPUT && event.code == UI_FF_ERASE) {
+        uinput_ff_erase erase = {};
+        erase.request_id = uint32_t(event.value);
+        if (ioctl(vjoy->fd, UI_BEGIN_FF_ERASE, &erase) < 0) return;
+        if (erase.effect_id < max_ff_effects) {
+            vjoy->ff_effect_valid[erase.effect_id] = false;
+        }
+        erase.retval = 0;
+        ioctl(vjoy->fd, UI_END_FF_ERASE, &erase);
+    } else if (event.type == EV_FF && event.code == FF_GAIN) {
+        vjoy->ff_gain = std::clamp(event.value / float(0xFFFF), 0.f, 1.f);
+    } else if (event.type == EV_FF && event.code < max_ff_effects && vjoy->ff_effect_valid[event.code]) {
+        // uinput stamps events with CLOCK_MONOTONIC, which matches steady_clock
+        auto issued = std::chrono::steady_clock::time_point(std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::seconds(event.input_event_sec) + std::chrono::microseconds(event.input_event_usec)));
+
+        if (event.value == 0) {
+            DispatchForceFeedback(vjoy, 0.f, 0.f, 0, issued);
+            return;
+        }
+
+        auto& effect = vjoy->ff_effects[event.code];
+        float low = 0.f, high = 0.f;
+        switch (effect.type) {
+            case FF_RUMBLE:
+                low  = effect.u.rumble.strong_magnitude / float(0xFFFF);
+                high = effect.u.rumble.weak_magnitude   / float(0xFFFF);
+                break;
+            case FF_PERIODIC:
+                low = high = std::abs(effect.u.periodic.magnitude) / float(0x7FFF);
+                break;
+            case FF_CONSTANT:
+                low = high = std::abs(effect.u.constant.level) / float(0x7FFF);
+                break;
+        }
+
+        uint32_t duration_ms = effect.replay.length ? effect.replay.length : 0xFFFF;
+        DispatchForceFeedback(vjoy, low * vjoy->ff_gain, high * vjoy->ff_gain, duration_ms, issued);
+    }
+}
+
+static
+void RunForceFeedbackThread(std::stop_token stop)
+{
+    std::vector<pollfd> fds;
+    std::array<input_event, 64> events;
+
+    while (!stop.stop_requested()) {
+        fds.clear();
+        fds.push_back({ .fd = ff_thread.wake_fd, .events = POLLIN });
+        {
+            std::scoped_lock _{ ff_thread.mutex };
+            for (auto* vjoy : ff_thread.devices) {
+                fds.push_back({ .fd = vjoy->fd, .events = POLLIN });
+            }
+        }
+
+        if (poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) continue;
+            LogWarn("Force feedback poll failed: {}", std::strerror(errno));
+            return;
+        }
+
+        if (fds[0].revents & POLLIN) {
+            uint64_t value;
+            [[maybe_unused]] auto res = ::read(ff_thread.wake_fd, &value, sizeof(value));
+        }
+
+        MAPPER_TRACE_SPAN("Force Feedback");
+
+        std::scoped_lock _{ ff_thread.mutex };
+        for (auto& pfd : fds | std::views::drop(1)) {
+            if (!(pfd.revents & POLLIN)) continue;
+
+            // Device may have been destroyed since the poll set was built
+            auto iter = std::ranges::find_if(ff_thread.devices, [&](auto* vjoy) { return vjoy->fd == pfd.fd; });
+            if (iter == ff_thread.devices.end()) continue;
+
+            ssize_t bytes;
+            while ((bytes = ::read(pfd.fd, events.data(), sizeof(events))) > 0) {
+                for (auto& event : std::span(events.data(), size_t(bytes) / sizeof(input_event))) {
+                    HandleForceFeedbackEvent(*iter, event);
+                }
+            }
+        }
+    }
+}
+
+static
+void WakeForceFeedbackThread()
+{
+    uint64_t value = 1;
+    [[maybe_unused]] auto res = ::write(ff_thread.wake_fd, &value, sizeof(value));
+}
+
+static
+void RegisterForceFeedback(VirtualJoystick_EvDev* vjoy)
+{
+    std::scoped_lock _{ ff_thread.mutex };
+
+    if (!ff_thread.thread.joinable()) {
+        ff_thread.wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        ff_thread.thread = std::jthread([](std::stop_token stop) {
+            std::stop_callback wake{ stop, WakeForceFeedbackThread };
+            MAPPER_TRACE_THREAD("Force Feedback");
+            RunForceFeedbackThread(stop);
+        });
+    }
+
+    ff_thread.devices.push_back(vjoy);
+    WakeForceFeedbackThread();
+}
+
+static
+void UnregisterForceFeedback(VirtualJoystick_EvDev* vjoy)
+{
+    std::scoped_lock _{ ff_thread.mutex };
+    std::erase(ff_thread.devices, vjoy);
+    WakeForceFeedbackThread();
+}
+
+// -----------------------------------------------------------------------------
+//          Virtual Joystick
+// -----------------------------------------------------------------------------
+
+// Idle devices, only accessed from the engine thread
+struct PooledVirtualJoystick
+{
+    VirtualJoystick_EvDev* vjoy;
+    std::chrono::steady_clock::time_point released;
+};
+
+static std::vector<PooledVirtualJoystick> vjoystick_pool;
+
+static
+void DestroyDevice(VirtualJoystick_EvDev* vjoy)
+{
+    if (vjoy->fd >= 0) {
+        if (vjoy->force_feedback) {
+            UnregisterForceFeedback(vjoy);
+        }
+
+        ioctl(vjoy->fd, UI_DEV_DESTROY);
+        close(vjoy->fd);
+    }
+
+    delete vjoy;
+}
+
+static
+void ResetPooledDevice(VirtualJoystick_EvDev* vjoy)
+{
+    // Outputs are already neutral, and last_axes/last_buttons still match what the device reports
+    vjoy->dirty = false;
+    vjoy->button_edge = false;
+    vjoy->next_report = {};
+    vjoy->reports_emitted = 0;
+    vjoy->reports_coalesced = 0;
+    vjoy->report_deferred = false;
+    vjoy->report_absorbed = false;
+    SetForceFeedbackRoute(vjoy, {});
+
+    // Effects uploaded by applications stay valid, as far as they can tell the device never went away
+    vjoy->ff_stats.uploads = 0;
+    vjoy->ff_stats.plays = 0;
+    vjoy->ff_stats.dropped = 0;
+    vjoy->ff_stats.average_round_trip_ns = 0;
+}
+
+std::optional<std::chrono::steady_clock::time_point> TrimVirtualJoystickPool(std::chrono::steady_clock::time_point now)
+{
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+    std::erase_if(vjoystick_pool, [&](const PooledVirtualJoystick& pooled) {
+        auto expiry = pooled.released + vjoystick_pool_grace;
+        if (now < expiry) {
+            if (!deadline || expiry < *deadline) deadline = expiry;
+            return false;
+        }
+        Log("Destroying idle virtual joystick [{}]", pooled.vjoy->name);
+        DestroyDevice(pooled.vjoy);
+        return true;
+    });
+    return deadline;
+}
+
+void DestroyPooledVirtualJoystick(VirtualJoystick* vjoy)
+{
+    std::erase_if(vjoystick_pool, [&](const PooledVirtualJoystick& pooled) {
+        if (pooled.vjoy != vjoy) return false;
+        DestroyDevice(pooled.vjoy);
+        return true;
+    });
+}
+
 VirtualJoystick* CreateVirtualJoystick(const VirtualJoystickDesc& desc)
 {
-    auto vjoy = new VirtualJoystick_EvDev{{desc}};
-    vjoy->dev = libevdev_new();
-    libevdev_set_name(vjoy->dev, desc.name.c_str());
-    libevdev_set_id_bustype(vjoy->dev, BUS_VIRTUAL);
-    libevdev_set_id_vendor(vjoy->dev, desc.vendor_id);
-    libevdev_set_id_product(vjoy->dev, desc.product_id);
-    libevdev_set_id_version(vjoy->dev, desc.version);
+    if (null_output) {
+        return new VirtualJoystick_EvDev{{desc}};
+    }
+
+    auto pooled = std::ranges::find_if(vjoystick_pool, [&](const PooledVirtualJoystick& pooled) {
+        return static_cast<const VirtualJoystickDesc&>(*pooled.vjoy) == desc;
+    });
+    if (pooled != vjoystick_pool.end()) {
+        auto vjoy = pooled->vjoy;
+        vjoystick_pool.erase(pooled);
+        ResetPooledDevice(vjoy);
+        LogDebug("Reusing virtual joystick [{}]", desc.name);
+        return vjoy;
+    }
+
+    // Devices are created through uinput directly, as ff_effects_max has to be
+    // provided at setup for force feedback capable devices
+
+    int fd = open("/dev/uinput", O_RDWR | O_NONBLOCK | O_CLOEXEC);
+    if (fd < 0) {
+        Error("Failed to open /dev/uinput: {}", std::strerror(errno));
+    }
+
+    auto fail = [&](const char* step) {
+        auto error = errno;
+        close(fd);
+        Error("Failed to create virtual joystick [{}] ({}): {}", desc.name, step, std::strerror(error));
+    };
 
     if (desc.num_axes) {
-        libevdev_enable_event_type(vjoy->dev, EV_ABS);
-        for (uint32_t i = 0; i < vjoy->num_axes; ++i) {
-            input_absinfo info {
-                .minimum = -axis_max_value,
-                .maximum =  axis_max_value,
-                .resolution = 1,
-            };
-            libevdev_enable_event_code(vjoy->dev, EV_ABS, axis_codes[i], &info);
+        if (ioctl(fd, UI_SET_EVBIT, EV_ABS) < 0) fail("EV_ABS");
+        for (uint32_t i = 0; i < desc.num_axes; ++i) {
+            uinput_abs_setup abs = {};
+            abs.code = uint16_t(axis_codes[i]);
+            abs.absinfo.minimum = -axis_max_value;
+            abs.absinfo.maximum =  axis_max_value;
+            abs.absinfo.resolution = 1;
+            if (ioctl(fd, UI_SET_ABSBIT, axis_codes[i]) < 0) fail("UI_SET_ABSBIT");
+            if (ioctl(fd, UI_ABS_SETUP, &abs) < 0) fail("UI_ABS_SETUP");
         }
     }
 
     if (desc.num_buttons) {
-        libevdev_enable_event_type(vjoy->dev, EV_KEY);
-        for (uint32_t i = 0; i < vjoy->num_buttons; ++i) {
-            libevdev_enable_event_code(vjoy->dev, EV_KEY, button_codes[i], nullptr);
+        if (ioctl(fd, UI_SET_EVBIT, EV_KEY) < 0) fail("EV_KEY");
+        for (uint32_t i = 0; i < desc.num_buttons; ++i) {
+            if (ioctl(fd, UI_SET_KEYBIT, button_codes[i]) < 0) fail("UI_SET_KEYBIT");
+        }
+    }
+
+    if (desc.force_feedback) {
+        if (ioctl(fd, UI_SET_EVBIT, EV_FF) < 0) fail("EV_FF");
+        for (auto code : { FF_RUMBLE, FF_PERIODIC, FF_CONSTANT, FF_SINE, FF_SQUARE, FF_TRIANGLE, FF_GAIN }) {
+            if (ioctl(fd, UI_SET_FFBIT, code) < 0) fail("UI_SET_FFBIT");
         }
     }
 
-    libevdev_uinput_create_from_device(vjoy->dev, LIBEVDEV_UINPUT_OPEN_MANAGED, &vjoy->uidev);
+    uinput_setup setup = {};
+    setup.id.bustype = BUS_VIRTUAL;
+    setup.id.vendor = desc.vendor_id;
+    setup.id.product = desc.product_id;
+    setup.id.version = desc.version;
+    std::strncpy(setup.name, desc.name.c_str(), UINPUT_MAX_NAME_SIZE - 1);
+    setup.ff_effects_max = desc.force_feedback ? max_ff_effects : 0;
+
+    if (ioctl(fd, UI_DEV_SETUP, &setup) < 0) fail("UI_DEV_SETUP");
+    if (ioctl(fd, UI_DEV_CREATE) < 0) fail("UI_DEV_CREATE");
+
+    auto vjoy = new VirtualJoystick_EvDev{{desc}};
+    vjoy->fd = fd;
+
+    if (desc.force_feedback) {
+        RegisterForceFeedback(vjoy);
+    }
 
     return vjoy;
 }
@@ -107,41 +405,71 @@ void VirtualJoystick::Destroy()
 {
     auto self = static_cast<VirtualJoystick_EvDev*>(this);
 
-    libevdev_uinput_destroy(self->uidev);
-    libevdev_free(self->dev);
+    if (self->fd < 0) {
+        DestroyDevice(self);
+        return;
+    }
+
+    // Release every output so nothing stays held while the device sits in the pool
+    self->axes = {};
+    self->buttons = {};
+    self->dirty = true;
+    self->Update();
+
+    // Force feedback is still serviced while pooled, so applications never block on an idle device
+    SetForceFeedbackRoute(self, {});
 
-    delete self;
+    vjoystick_pool.push_back({ self, std::chrono::steady_clock::now() });
 }
 
 bool VirtualJoystick::Update()
 {
     auto self = static_cast<VirtualJoystick_EvDev*>(this);
 
-    bool any_change = false;
+    if (!self->dirty) return false;
+    self->dirty = false;
 
-    constexpr auto update = [](auto& last, auto cur) -> bool {
-        if (cur != last) {
-            last = cur;
-            return true;
-        }
-        return false;
+    // All changes for this frame are submitted with a single write
+    std::array<input_event, max_axis_count + max_button_count + 1> events;
+    uint32_t count = 0;
+
+    auto push = [&](uint16_t type, uint16_t code, int32_t value) {
+        auto& event = events[count++];
+        event = {};
+        event.type = type;
+        event.code = code;
+        event.value = value;
     };
 
     for (uint32_t i = 0; i < self->num_axes; ++i) {
-        if (!update(self->last_axes[i], self->axes[i])) continue;
-        libevdev_uinput_write_event(self->uidev, EV_ABS, axis_codes[i], int16_t(self->axes[i] * axis_max_value));
-        any_change = true;
+        auto value = QuantizeAxis(self->axes[i]);
+        if (value == self->last_axes[i]) continue;
+        self->last_axes[i] = value;
+        push(EV_ABS, axis_codes[i], value);
     }
 
     for (uint32_t i = 0; i < self->num_buttons; ++i) {
-        if (!update(self->last_buttons[i], self->buttons[i])) continue;
-        libevdev_uinput_write_event(self->uidev, EV_KEY, button_codes[i], self->buttons[i]);
-        any_change = true;
+        if (self->buttons[i] == self->last_buttons[i]) continue;
+        self->last_buttons[i] = self->buttons[i];
+        push(EV_KEY, button_codes[i], self->buttons[i]);
     }
 
-    if (any_change) {
-        libevdev_uinput_write_event(self->uidev, EV_SYN, SYN_REPORT, 0);
+    if (!count) return false;
+
+    push(EV_SYN, SYN_REPORT, 0);
+
+    auto fd = self->fd;
+    if (fd < 0) return true;
+
+    auto size = count * sizeof(input_event);
+    ssize_t written;
+    do {
+        written = ::write(fd, events.data(), size);
+    } while (written < 0 && errno == EINTR);
+
+    if (written != ssize_t(size)) {
+        LogWarn("Failed to write events to virtual joystick [{}]: {}", self->name, written < 0 ? std::strerror(errno) : "short write");
     }
 
-    return any_change;
+    return true;
 }
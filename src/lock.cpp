@@ -0,0 +1,58 @@
+#include "lock.hpp"
+
+#if defined(MAPPER_LOCK_STATS)
+
+#include <algorithm>
+#include <bit>
+
+// Sites are claimed on first use and never released, lookups are lock-free so
+// that recording never takes another lock.
+
+static std::array<LockSiteStats, max_lock_sites> lock_sites;
+
+void LockTimeStats::Record(int64_t ns)
+{
+    auto value = uint64_t(std::max<int64_t>(ns, 0));
+
+    total_ns.fetch_add(value, std::memory_order_relaxed);
+
+    auto prev = max_ns.load(std::memory_order_relaxed);
+    while (value > prev && !max_ns.compare_exchange_weak(prev, value, std::memory_order_relaxed));
+
+    auto bucket = std::min<uint32_t>(std::bit_width(value / 1000), lock_histogram_buckets - 1);
+    histogram[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+LockSiteStats* FindLockSite(const LockLocation& location)
+{
+    auto file = location.file_name();
+    auto line = location.line();
+
+    for (auto& site : lock_sites) {
+        auto site_file = site.file.load(std::memory_order_acquire);
+        if (!site_file) {
+            if (site.file.compare_exchange_strong(site_file, file, std::memory_order_acq_rel)) {
+                site.line.store(line, std::memory_order_relaxed);
+                site.ready.store(true, std::memory_order_release);
+                return &site;
+            }
+        }
+
+        // Wait out a concurrent claim of this slot before comparing lines
+        while (!site.ready.load(std::memory_order_acquire));
+
+        if (site_file == file && site.line.load(std::memory_order_relaxed) == line) {
+            return &site;
+        }
+    }
+
+    // Out of sites, acquisitions from here are not recorded
+    return nullptr;
+}
+
+std::span<LockSiteStats> GetLockSites()
+{
+    return lock_sites;
+}
+
+#endif
@@ -1,7 +1,18 @@
 #pragma once
 
+#include "trace.hpp"
+
 #include <shared_mutex>
 
+#if defined(MAPPER_LOCK_STATS)
+#include <source_location>
+#include <atomic>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <span>
+#endif
+
 enum class LockState
 {
     Unlocked,
@@ -9,25 +20,111 @@ enum class LockState
     Unique,
 };
 
+// -----------------------------------------------------------------------------
+//          Lock Statistics
+// -----------------------------------------------------------------------------
+
+// With MAPPER_LOCK_STATS defined every acquisition through SharedLockGuard
+// records how long it waited for the lock and how long it was held, keyed by
+// the source location that constructed the guard. Otherwise the location is
+// an empty tag and no timing code is emitted.
+
+#if defined(MAPPER_LOCK_STATS)
+
+constexpr bool lock_stats_enabled = true;
+
+// Bucket 0 counts durations under 1us, bucket i counts [2^(i-1), 2^i) us, the last bucket is open ended
+constexpr uint32_t lock_histogram_buckets = 20;
+constexpr uint32_t max_lock_sites = 32;
+
+struct LockTimeStats
+{
+    std::atomic<uint64_t> total_ns = 0;
+    std::atomic<uint64_t> max_ns = 0;
+    std::array<std::atomic<uint64_t>, lock_histogram_buckets> histogram = {};
+
+    void Record(int64_t ns);
+};
+
+struct LockModeStats
+{
+    std::atomic<uint64_t> acquisitions = 0;
+    LockTimeStats wait;
+    LockTimeStats hold;
+};
+
+struct LockSiteStats
+{
+    std::atomic<const char*> file = nullptr;
+    std::atomic<uint32_t> line = 0;
+    std::atomic<bool> ready = false;
+
+    // Indexed by LockState::Shared - 1 and LockState::Unique - 1
+    std::array<LockModeStats, 2> modes;
+};
+
+using LockLocation = std::source_location;
+
+LockSiteStats* FindLockSite(const LockLocation& location);
+std::span<LockSiteStats> GetLockSites();
+
+inline
+int64_t LockClockNow()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+#else
+
+constexpr bool lock_stats_enabled = false;
+
+struct LockLocation
+{
+    static constexpr LockLocation current() { return {}; }
+};
+
+#endif
+
+// -----------------------------------------------------------------------------
+
 struct SharedLockGuard
 {
     std::shared_mutex* mutex;
     LockState prior_state;
     LockState state;
 
-    SharedLockGuard(std::shared_mutex& _mutex, LockState initial_state, LockState _prior_state = LockState::Unlocked)
+#if defined(MAPPER_LOCK_STATS)
+    LockSiteStats* site;
+    int64_t acquired_ns = 0;
+
+    // Guard this one is nested in, which owns the lock while this guard is in its prior state
+    SharedLockGuard* parent = nullptr;
+#endif
+
+    SharedLockGuard(std::shared_mutex& _mutex, LockState initial_state, LockState _prior_state = LockState::Unlocked, LockLocation location = LockLocation::current())
         : mutex(&_mutex)
         , prior_state(_prior_state)
         , state(_prior_state)
     {
+#if defined(MAPPER_LOCK_STATS)
+        site = FindLockSite(location);
+#else
+        (void)location;
+#endif
         SetState(initial_state);
     }
 
-    SharedLockGuard(SharedLockGuard& _lock, LockState initial_state)
+    SharedLockGuard(SharedLockGuard& _lock, LockState initial_state, LockLocation location = LockLocation::current())
         : mutex(_lock.mutex)
         , prior_state(_lock.state)
         , state(_lock.state)
     {
+#if defined(MAPPER_LOCK_STATS)
+        site = FindLockSite(location);
+        parent = &_lock;
+#else
+        (void)location;
+#endif
         SetState(initial_state);
     }
 
@@ -45,11 +142,8 @@ struct SharedLockGuard
     {
         if (new_state == state) return;
 
-        if      (state == LockState::Shared) mutex->unlock_shared();
-        else if (state == LockState::Unique) mutex->unlock();
-
-        if      (new_state == LockState::Shared) mutex->lock_shared();
-        else if (new_state == LockState::Unique) mutex->lock();
+        Release();
+        Acquire(new_state);
 
         state = new_state;
     }
@@ -57,22 +151,72 @@ struct SharedLockGuard
     void LockUnique()
     {
         if (state == LockState::Unique) return;
-        if (state == LockState::Shared) mutex->unlock_shared();
-        mutex->lock();
+        if (state == LockState::Shared) Release();
+        Acquire(LockState::Unique);
         state = LockState::Unique;
     }
 
     void LockShared()
     {
         if (state == LockState::Shared) return;
-        if (state == LockState::Unique) mutex->unlock();
-        mutex->lock_shared();
+        if (state == LockState::Unique) Release();
+        Acquire(LockState::Shared);
         state = LockState::Shared;
     }
 
     void Unlock()
     {
-        if      (state == LockState::Shared) mutex->unlock_shared();
-        else if (state == LockState::Unique) mutex->unlock();
+        Release();
+    }
+
+    void Acquire(LockState new_state)
+    {
+        if (new_state == LockState::Unlocked) return;
+
+#if defined(MAPPER_LOCK_STATS)
+        auto start = LockClockNow();
+#endif
+
+        {
+            MAPPER_TRACE_SPAN(new_state == LockState::Shared ? "Lock Wait (shared)" : "Lock Wait (unique)");
+            if (new_state == LockState::Shared) mutex->lock_shared();
+            else                                mutex->lock();
+        }
+
+#if defined(MAPPER_LOCK_STATS)
+        // Restoring the state of the enclosing guard counts against its site and restarts its hold
+        auto owner = StatsOwner(new_state);
+        owner->acquired_ns = LockClockNow();
+        if (owner->site) {
+            auto& mode = owner->site->modes[size_t(new_state) - 1];
+            mode.acquisitions.fetch_add(1, std::memory_order_relaxed);
+            mode.wait.Record(owner->acquired_ns - start);
+        }
+#endif
+    }
+
+#if defined(MAPPER_LOCK_STATS)
+    SharedLockGuard* StatsOwner(LockState held)
+    {
+        return parent && held == prior_state ? parent->StatsOwner(held) : this;
+    }
+#endif
+
+    void Release()
+    {
+        if (state == LockState::Unlocked) return;
+
+#if defined(MAPPER_LOCK_STATS)
+        // Guards nested inside another guard start out holding a lock they did not acquire,
+        // releasing it ends the hold of the enclosing guard
+        auto owner = StatsOwner(state);
+        if (owner->site && owner->acquired_ns) {
+            owner->site->modes[size_t(state) - 1].hold.Record(LockClockNow() - owner->acquired_ns);
+        }
+        owner->acquired_ns = 0;
+#endif
+
+        if (state == LockState::Shared) mutex->unlock_shared();
+        else                            mutex->unlock();
     }
 };
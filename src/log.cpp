@@ -0,0 +1,238 @@
+#include "common.hpp"
+
+#include <array>
+#include <iostream>
+#include <mutex>
+#include <optional>
+#include <semaphore>
+#include <string>
+#include <thread>
+
+// -----------------------------------------------------------------------------
+//          Log Ring
+// -----------------------------------------------------------------------------
+
+constexpr size_t log_ring_size = 1024;
+constexpr size_t log_message_capacity = 240;
+
+struct LogSlot
+{
+    // Bounded multi-producer queue, see Dmitry Vyukov's MPMC queue
+    std::atomic<uint64_t> sequence;
+    uint64_t position;
+    LogLevel level;
+    uint32_t length;
+
+    // Bytes cut off the end of a message that did not fit
+    uint32_t truncated;
+    std::array<char, log_message_capacity> text;
+};
+
+struct LogRing
+{
+    std::array<LogSlot, log_ring_size> slots;
+    std::atomic<uint64_t> enqueue_pos = 0;
+    uint64_t dequeue_pos = 0;
+    std::atomic<uint64_t> dropped = 0;
+
+    // Set by the log thread before it blocks, producers only signal the semaphore while it is set
+    std::atomic<bool> sleeping = false;
+    std::binary_semaphore wake{0};
+
+    LogRing()
+    {
+        for (size_t i = 0; i < log_ring_size; ++i) {
+            slots[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+};
+
+static LogRing log_ring;
+
+static
+void WakeLogThread()
+{
+    // Pairs with the fence in the log thread, either it sees the new state or we see it sleeping
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (log_ring.sleeping.load(std::memory_order_relaxed) && log_ring.sleeping.exchange(false)) {
+        log_ring.wake.release();
+    }
+}
+
+LogSlot* AcquireLogSlot()
+{
+    auto pos = log_ring.enqueue_pos.load(std::memory_order_relaxed);
+    for (;;) {
+        auto& slot = log_ring.slots[pos % log_ring_size];
+        auto seq = slot.sequence.load(std::memory_order_acquire);
+        auto diff = int64_t(seq) - int64_t(pos);
+        if (diff == 0) {
+            if (log_ring.enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                slot.position = pos;
+                return &slot;
+            }
+        } else if (diff < 0) {
+            // Full, never block the caller
+            log_ring.dropped.fetch_add(1, std::memory_order_relaxed);
+            return nullptr;
+        } else {
+            pos = log_ring.enqueue_pos.load(std::memory_order_relaxed);
+        }
+    }
+}
+
+std::span<char> GetLogSlotBuffer(LogSlot* slot)
+{
+    return slot->text;
+}
+
+void CommitLogSlot(LogSlot* slot, LogLevel level, size_t length)
+{
+    slot->level = level;
+    slot->length = uint32_t(std::min(length, log_message_capacity));
+    slot->truncated = uint32_t(length - slot->length);
+    slot->sequence.store(slot->position + 1, std::memory_order_release);
+    WakeLogThread();
+}
+
+// -----------------------------------------------------------------------------
+//          Log Thread
+// -----------------------------------------------------------------------------
+
+struct LogWriter
+{
+    // Identical messages within a second of the last written one are collapsed into a repeat count
+    std::string last_message;
+    LogLevel last_level = LogLevel::Info;
+    uint64_t repeats = 0;
+    std::chrono::steady_clock::time_point last_write = {};
+
+    void Write(LogLevel level, std::string_view message, uint32_t truncated = 0)
+    {
+        constexpr const char* prefixes[] = { "[DEBUG] ", "", "[WARN] ", "[ERROR] " };
+        std::cout << prefixes[size_t(level)] << message;
+        if (truncated) std::cout << std::format("... ({} bytes truncated)", truncated);
+        std::cout << '\n';
+    }
+
+    void FlushRepeats()
+    {
+        if (!repeats) return;
+        std::cout << std::format("  (last message repeated {} times)\n", repeats);
+        repeats = 0;
+    }
+
+    void Push(LogLevel level, std::string_view message, uint32_t truncated)
+    {
+        auto now = std::chrono::steady_clock::now();
+        if (level == last_level && message == last_message && now - last_write < std::chrono::seconds(1)) {
+            ++repeats;
+            return;
+        }
+        FlushRepeats();
+        Write(level, message, truncated);
+        last_message = message;
+        last_level = level;
+        last_write = now;
+    }
+};
+
+static
+bool DrainLogRing(LogWriter& writer)
+{
+    bool any = false;
+
+    for (;;) {
+        auto pos = log_ring.dequeue_pos;
+        auto& slot = log_ring.slots[pos % log_ring_size];
+        if (slot.sequence.load(std::memory_order_acquire) != pos + 1) break;
+
+        writer.Push(slot.level, std::string_view(slot.text.data(), slot.length), slot.truncated);
+
+        slot.sequence.store(pos + log_ring_size, std::memory_order_release);
+        log_ring.dequeue_pos = pos + 1;
+        any = true;
+    }
+
+    if (auto dropped = log_ring.dropped.exchange(0, std::memory_order_relaxed)) {
+        writer.FlushRepeats();
+        writer.Write(LogLevel::Warn, std::format("Log overflowed, {} messages dropped", dropped));
+        any = true;
+    }
+
+    return any;
+}
+
+static
+bool IsLogRingEmpty()
+{
+    auto pos = log_ring.dequeue_pos;
+    return log_ring.slots[pos % log_ring_size].sequence.load(std::memory_order_acquire) != pos + 1
+        && !log_ring.dropped.load(std::memory_order_relaxed);
+}
+
+// Blocks until a producer commits a message, the thread is stopped or the timeout passes
+static
+void WaitForLogMessages(std::stop_token stop, std::optional<std::chrono::steady_clock::duration> timeout)
+{
+    log_ring.sleeping.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    bool woken = false;
+    if (IsLogRingEmpty() && !stop.stop_requested()) {
+        if (timeout) {
+            woken = log_ring.wake.try_acquire_for(*timeout);
+        } else {
+            log_ring.wake.acquire();
+            woken = true;
+        }
+    }
+
+    // A producer that cleared the flag has signalled, or is about to, consume it so the semaphore stays binary
+    if (!log_ring.sleeping.exchange(false) && !woken) {
+        log_ring.wake.acquire();
+    }
+}
+
+// The core and the executable each hold a reference, the thread runs while either does
+static std::mutex log_thread_mutex;
+static uint32_t log_thread_refs = 0;
+static std::jthread log_thread;
+
+void StartLogThread()
+{
+    std::scoped_lock _{ log_thread_mutex };
+    if (log_thread_refs++) return;
+
+    log_thread = std::jthread([](std::stop_token stop) {
+        LogWriter writer;
+        while (!stop.stop_requested()) {
+            bool wrote = DrainLogRing(writer);
+            if (writer.repeats && std::chrono::steady_clock::now() - writer.last_write > std::chrono::seconds(1)) {
+                writer.FlushRepeats();
+                wrote = true;
+            }
+            if (wrote) {
+                std::cout.flush();
+            }
+
+            // Only wake up on a timer while a repeat count is waiting to be flushed
+            std::optional<std::chrono::steady_clock::duration> timeout;
+            if (writer.repeats) timeout = writer.last_write + std::chrono::seconds(1) - std::chrono::steady_clock::now();
+            WaitForLogMessages(stop, timeout);
+        }
+        DrainLogRing(writer);
+        writer.FlushRepeats();
+        std::cout.flush();
+    });
+}
+
+void StopLogThread()
+{
+    std::scoped_lock _{ log_thread_mutex };
+    if (!log_thread_refs || --log_thread_refs) return;
+
+    log_thread.request_stop();
+    WakeLogThread();
+    log_thread = {};
+}
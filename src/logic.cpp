@@ -0,0 +1,216 @@
+#include "mapper.hpp"
+
+// -----------------------------------------------------------------------------
+//          Primitives
+// -----------------------------------------------------------------------------
+
+void LogicPrimitive::SetInput(uint32_t slot, bool state, std::chrono::steady_clock::time_point now)
+{
+    bool rising = state && !held[slot];
+    bool falling = !state && held[slot];
+    held[slot] = state;
+
+    switch (type) {
+        case LogicType::Toggle:
+            if (rising) output = !output;
+            break;
+
+        case LogicType::Chord:
+            output = std::ranges::all_of(held, [](bool h) { return h; });
+            break;
+
+        case LogicType::Layer:
+            if (latch) {
+                if (rising) layer = layer == slot + 1 ? 0 : slot + 1;
+            } else {
+                // Most recently declared held selector wins
+                layer = 0;
+                for (uint32_t i = 0; i < held.size(); ++i) {
+                    if (held[i]) layer = i + 1;
+                }
+            }
+            break;
+
+        case LogicType::PressDetector:
+            if (rising) {
+                deadline = now + long_press;
+            } else if (falling) {
+                if (output) {
+                    // Long presses never count as taps
+                    output = false;
+                    taps = 0;
+                    deadline = std::nullopt;
+                } else if (++taps >= 2) {
+                    double_tapped = true;
+                    taps = 0;
+                    deadline = std::nullopt;
+                } else if (double_tap.count() > 0) {
+                    deadline = now + double_tap;
+                } else {
+                    tapped = true;
+                    taps = 0;
+                    deadline = std::nullopt;
+                }
+            }
+            break;
+
+        case LogicType::Shift:
+            // Slot 0 is the modifier, slot 1 the input. Shift state is sampled on press
+            if (slot == 1 && rising) {
+                shifted = held[0];
+                output = !held[0];
+            } else if (slot == 1 && falling) {
+                shifted = false;
+                output = false;
+            }
+            break;
+    }
+}
+
+void LogicPrimitive::Expire(std::chrono::steady_clock::time_point now)
+{
+    if (!deadline || now < *deadline) return;
+    deadline = std::nullopt;
+
+    if (type != LogicType::PressDetector) return;
+
+    if (held[0]) {
+        output = true;
+        taps = 0;
+    } else if (taps == 1) {
+        tapped = true;
+        taps = 0;
+    }
+}
+
+// -----------------------------------------------------------------------------
+//          Graph
+// -----------------------------------------------------------------------------
+
+static
+uint64_t HashLogicInput(const LogicInput& input)
+{
+    return (input.device * 0x9E3779B97F4A7C15ull) ^ (uint64_t(input.index) << 8) ^ uint64_t(input.source);
+}
+
+static
+bool ReadLogicInput(const LogicInput& input)
+{
+    switch (input.source) {
+        case LogicSource::JoystickButton:
+            if (auto joystick = SDL_GetJoystickFromID(SDL_JoystickID(input.device))) {
+                return SDL_GetJoystickButton(joystick, int(input.index));
+            }
+            return false;
+        case LogicSource::DeviceKey:
+            return reinterpret_cast<InputDevice*>(input.device)->state.keys[input.index];
+        case LogicSource::Primitive:
+            return reinterpret_cast<LogicPrimitive*>(input.device)->Value();
+    }
+    return false;
+}
+
+LogicPrimitive* LogicGraph::Create(LogicPrimitive desc)
+{
+    auto primitive = new LogicPrimitive(std::move(desc));
+
+    // Start from the current input state without generating edges
+    primitive->held.resize(primitive->inputs.size());
+    for (uint32_t i = 0; i < primitive->inputs.size(); ++i) {
+        auto& input = primitive->inputs[i];
+        primitive->held[i] = ReadLogicInput(input);
+        listeners[HashLogicInput(input)].push_back({ input, primitive, i });
+
+        if (input.source == LogicSource::DeviceKey) {
+            auto device = reinterpret_cast<InputDevice*>(input.device);
+            device_keys.try_emplace(device, device->state.keys);
+        }
+    }
+    if (primitive->type == LogicType::Chord) {
+        primitive->output = std::ranges::all_of(primitive->held, [](bool h) { return h; });
+    }
+
+    primitives.emplace_back(primitive);
+    return primitive;
+}
+
+void LogicGraph::Clear()
+{
+    for (auto* primitive : primitives) {
+        delete primitive;
+    }
+    primitives.clear();
+    listeners.clear();
+    device_keys.clear();
+}
+
+void LogicGraph::Dispatch(const LogicInput& input, bool state, std::chrono::steady_clock::time_point now)
+{
+    auto found = listeners.find(HashLogicInput(input));
+    if (found == listeners.end()) return;
+
+    for (auto& listener : found->second) {
+        if (listener.input != input) continue;
+
+        auto* primitive = listener.primitive;
+        bool before = primitive->Value();
+        primitive->SetInput(listener.slot, state, now);
+
+        if (primitive->Value() != before) {
+            Dispatch({ .source = LogicSource::Primitive, .device = uint64_t(uintptr_t(primitive)) }, primitive->Value(), now);
+        }
+    }
+}
+
+std::optional<std::chrono::steady_clock::time_point> LogicGraph::Evaluate(std::span<const ButtonChange> changes, std::chrono::steady_clock::time_point now)
+{
+    if (primitives.empty()) return std::nullopt;
+
+    for (auto& change : changes) {
+        Dispatch({ .source = LogicSource::JoystickButton, .device = change.joystick, .index = change.button }, change.down, now);
+    }
+
+    for (auto& [device, last] : device_keys) {
+        auto& state = device->state;
+        auto changed = state.keys ^ last;
+        auto taps = state.pressed & ~state.keys & ~last;
+        if (changed.none() && taps.none()) continue;
+
+        for (uint32_t code = 0; code <= max_key_code; ++code) {
+            LogicInput input{ .source = LogicSource::DeviceKey, .device = uint64_t(uintptr_t(device)), .index = code };
+            if (changed[code]) {
+                Dispatch(input, state.keys[code], now);
+            } else if (taps[code]) {
+                // Pressed and released within one frame
+                Dispatch(input, true, now);
+                Dispatch(input, false, now);
+            }
+        }
+        last = state.keys;
+    }
+
+    for (auto* primitive : primitives) {
+        if (!primitive->deadline) continue;
+
+        bool before = primitive->Value();
+        primitive->Expire(now);
+        if (primitive->Value() != before) {
+            Dispatch({ .source = LogicSource::Primitive, .device = uint64_t(uintptr_t(primitive)) }, primitive->Value(), now);
+        }
+    }
+
+    std::optional<std::chrono::steady_clock::time_point> next;
+    for (auto* primitive : primitives) {
+        if (primitive->deadline && (!next || *primitive->deadline < *next)) next = primitive->deadline;
+    }
+
+    return next;
+}
+
+void LogicGraph::EndFrame()
+{
+    for (auto* primitive : primitives) {
+        primitive->tapped = false;
+        primitive->double_tapped = false;
+    }
+}
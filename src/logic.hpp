@@ -0,0 +1,117 @@
+#pragma once
+
+#include "vinput.hpp"
+
+#include <bitset>
+#include <chrono>
+#include <cstdint>
+#include <optional>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+struct InputDevice;
+
+// -----------------------------------------------------------------------------
+//          Logic Primitives
+// -----------------------------------------------------------------------------
+
+// Stateful discrete logic evaluated natively on input edges. Primitives only
+// run when one of their inputs changes (or a timer they armed expires), and
+// can be used as inputs to other primitives.
+
+enum class LogicSource : uint8_t
+{
+    JoystickButton,
+    DeviceKey,
+    Primitive,
+};
+
+struct LogicInput
+{
+    LogicSource source;
+
+    // SDL_JoystickID, InputDevice* or LogicPrimitive*
+    uint64_t device;
+    uint32_t index = 0;
+
+    bool operator==(const LogicInput&) const = default;
+};
+
+struct ButtonChange
+{
+    uint32_t joystick;
+    uint8_t button;
+    bool down;
+};
+
+enum class LogicType : uint8_t
+{
+    // Output flips on each press
+    Toggle,
+
+    // Output held while all inputs are held
+    Chord,
+
+    // Selects layer 1..N from N inputs, 0 when none. Latching layers stay selected until pressed again
+    Layer,
+
+    // Output held once the input is held past `long_press`, taps and double taps are reported as pulses
+    PressDetector,
+
+    // Input pressed while the modifier is held is reported as shifted until released
+    Shift,
+};
+
+struct LogicPrimitive
+{
+    LogicType type;
+    std::vector<LogicInput> inputs;
+    std::vector<bool> held;
+
+    bool output = false;
+    bool shifted = false;
+    uint32_t layer = 0;
+
+    // Pulses, visible for the update in which they fire
+    bool tapped = false;
+    bool double_tapped = false;
+
+    bool latch = false;
+    std::chrono::steady_clock::duration long_press = {};
+    std::chrono::steady_clock::duration double_tap = {};
+
+    uint32_t taps = 0;
+    std::optional<std::chrono::steady_clock::time_point> deadline;
+
+    // Boolean value seen by primitives using this one as an input
+    bool Value() const { return type == LogicType::Layer ? layer != 0 : output; }
+
+    void SetInput(uint32_t slot, bool state, std::chrono::steady_clock::time_point now);
+    void Expire(std::chrono::steady_clock::time_point now);
+};
+
+struct LogicGraph
+{
+    struct Listener
+    {
+        LogicInput input;
+        LogicPrimitive* primitive;
+        uint32_t slot;
+    };
+
+    std::vector<LogicPrimitive*> primitives;
+    std::unordered_map<uint64_t, std::vector<Listener>> listeners;
+    std::unordered_map<InputDevice*, std::bitset<max_key_code + 1>> device_keys;
+
+    LogicPrimitive* Create(LogicPrimitive primitive);
+    void Clear();
+
+    // Applies input changes since the last update, returns the earliest pending timer
+    std::optional<std::chrono::steady_clock::time_point> Evaluate(std::span<const ButtonChange> changes, std::chrono::steady_clock::time_point now);
+
+    // Clears pulses once scripts have seen them
+    void EndFrame();
+
+    void Dispatch(const LogicInput& input, bool state, std::chrono::steady_clock::time_point now);
+};
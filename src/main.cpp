@@ -1,10 +1,23 @@
 #include "mapper.hpp"
 
+#if !defined(MAPPER_HEADLESS)
+#include "gui.hpp"
+#endif
+
 // -----------------------------------------------------------------------------
 
 struct ProgramArgs
 {
     bool gui = false;
+    bool daemon = false;
+    bool attach = false;
+    size_t memory_limit = 0;
+    bool bytecode_cache = true;
+    bool dry_run = false;
+    bool external_inputs = false;
+    std::optional<std::filesystem::path> telemetry_path;
+    std::optional<std::filesystem::path> trace_path;
+    double gui_fps = 60.0;
     std::vector<std::filesystem::path> initial_script_paths;
 };
 
@@ -20,6 +33,36 @@ ProgramArgs ParseArgs(int argc, char* argv[])
     for (int i = 1; i < argc; ++i) {
         auto arg = std::string_view(argv[i]);
         if (arg == "--gui") args.gui = true;
+        else if (arg == "--daemon") args.daemon = true;
+        else if (arg == "--attach") args.attach = true;
+        else if (arg == "--no-bytecode-cache") args.bytecode_cache = false;
+        else if (arg == "--dry-run") args.dry_run = true;
+        else if (arg == "--external-inputs") args.external_inputs = true;
+        else if (arg == "--log-level") {
+            if (++i >= argc) Error("Error: --log-level requires one of debug, info, warn, error");
+            auto level = std::string_view(argv[i]);
+            if      (level == "debug") log_level = LogLevel::Debug;
+            else if (level == "info")  log_level = LogLevel::Info;
+            else if (level == "warn")  log_level = LogLevel::Warn;
+            else if (level == "error") log_level = LogLevel::Error;
+            else Error("Error: unknown log level: {}", level);
+        }
+        else if (arg == "--gui-fps") {
+            if (++i >= argc) Error("Error: --gui-fps requires a frame rate");
+            args.gui_fps = std::stod(argv[i]);
+        }
+        else if (arg == "--telemetry") {
+            if (++i >= argc) Error("Error: --telemetry requires a file path, e.g. /dev/shm/mapper-telemetry");
+            args.telemetry_path = argv[i];
+        }
+        else if (arg == "--trace") {
+            if (++i >= argc) Error("Error: --trace requires a file path, e.g. mapper-trace.json");
+            args.trace_path = argv[i];
+        }
+        else if (arg == "--memory-limit") {
+            if (++i >= argc) Error("Error: --memory-limit requires a size in MiB");
+            args.memory_limit = size_t(std::stoull(argv[i])) * 1024 * 1024;
+        }
         else {
             auto path = std::filesystem::path(arg);
             path = std::filesystem::canonical(path);
@@ -32,6 +75,12 @@ ProgramArgs ParseArgs(int argc, char* argv[])
         }
     }
 
+#if defined(MAPPER_HEADLESS)
+    if (args.gui || args.attach) {
+        Error("Error: this build has no GUI, use the mapper executable for --gui and --attach");
+    }
+#endif
+
     return args;
 }
 
@@ -41,17 +90,33 @@ static
 int Main(int argc, char* argv[]) try
 {
     auto args = ParseArgs(argc, argv);
-    Initialize();
+#if !defined(MAPPER_HEADLESS)
+    gui_max_fps = args.gui_fps;
+    if (args.attach) return RunGUIClient();
+#endif
+
+    StartCore({
+        .script_memory_limit = args.memory_limit,
+        .bytecode_cache      = args.bytecode_cache,
+        .null_output         = args.dry_run,
+        .external_inputs     = args.external_inputs,
+        .publish_state       = args.gui,
+        .daemon              = args.daemon,
+        .telemetry_path      = args.telemetry_path,
+        .trace_path          = args.trace_path,
+    });
+    // Also on errors, so that traces are still written
+    Defer stop_core = [] { StopCore(); };
+
     for (auto& script_path : args.initial_script_paths) {
         LoadScript(script_path);
     }
+#if !defined(MAPPER_HEADLESS)
     if (args.gui) OpenGUI();
+    Defer close_gui = [&] { if (args.gui) CloseGUI(); };
+#endif
 
-    while (ProcessEvents()) {
-        UpdateJoysticks();
-    }
-
-    if (args.gui) CloseGUI();
+    while (RunCoreFrame());
 
     return EXIT_SUCCESS;
 }
@@ -77,12 +142,16 @@ catch (...)
 
 int WinMain(HINSTANCE, HINSTANCE, LPSTR, int)
 {
+    StartLogThread();
     Main(__argc, __argv);
+    StopLogThread();
 }
 
 #endif
 
 int main(int argc, char* argv[])
 {
+    StartLogThread();
     Main(argc, argv);
+    StopLogThread();
 }
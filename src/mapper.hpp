@@ -3,6 +3,17 @@
 #include "common.hpp"
 #include "lock.hpp"
 #include "vjoystick.hpp"
+#include "vinput.hpp"
+#include "input_device.hpp"
+#include "arena.hpp"
+#include "ipc.hpp"
+#include "telemetry.hpp"
+#include "logic.hpp"
+#include "filters.hpp"
+#include "external_input.hpp"
+#include "trace.hpp"
+#include "persistent.hpp"
+#include "core.hpp"
 
 #include <algorithm>
 #include <unordered_set>
@@ -33,11 +44,51 @@ inline uint64_t frame = 0;
 inline std::unordered_set<SDL_Joystick*> joysticks;
 inline std::shared_mutex engine_mutex;
 
+// Earliest time at which a paced or integrated virtual device report is due
+inline std::optional<std::chrono::steady_clock::time_point> output_deadline;
+
+// Joystick button edges since the last update, consumed by logic primitives
+inline std::vector<ButtonChange> button_changes;
+
+// Earliest logic primitive timer, e.g. a long press threshold
+inline std::optional<std::chrono::steady_clock::time_point> logic_deadline;
+
+// Every axis sample since the last update, with device timestamps
+inline std::vector<AxisSample> axis_samples;
+
+// Calibration and jitter gating applied to axis events before they are sampled
+inline NoiseGates noise_gates;
+
+// Set while time based filters are still converging on their input
+inline std::optional<std::chrono::steady_clock::time_point> filter_deadline;
+
+// Earliest time at which an idle pooled virtual joystick is destroyed
+inline std::optional<std::chrono::steady_clock::time_point> vjoystick_pool_deadline;
+
 void Initialize();
+// Stops the hotplug thread, closes all joysticks and quits SDL, after all scripts are unloaded
+void Shutdown();
 bool ProcessEvents();
 void UpdateJoysticks();
 void PushJoystickUpdateEvent();
 
+// Snapshot of engine state for GUI clients, may live in shared memory
+inline StateRegion* state_region = nullptr;
+inline std::optional<std::chrono::steady_clock::time_point> state_publish_deadline;
+
+void QueueCommand(Command command);
+bool ExecuteQueuedCommands();
+void PublishState();
+// Forgets the plot selection and publish timing of a destroyed state region
+void ResetStatePublishing();
+void CapturePlotAxisEvent(const SDL_JoyAxisEvent& event);
+void CapturePlotSamples();
+
+// Optional telemetry file for external tools, updated every engine frame
+inline TelemetryRegion* telemetry = nullptr;
+
+void WriteTelemetry();
+
 // -----------------------------------------------------------------------------
 //          Scripts
 // -----------------------------------------------------------------------------
@@ -46,35 +97,106 @@ inline std::chrono::steady_clock::time_point last_script_run = {};
 inline std::chrono::duration<double, std::nano> average_script_dur;
 inline double average_script_util = 0.0;
 
+// Default memory limit applied to each script's arena, 0 = unlimited
+inline size_t script_memory_limit = 0;
+
+struct ScriptDeviceRequirement
+{
+    uint16_t vendor_id;
+    uint16_t product_id;
+};
+
+// Trace aborts are grouped by location and reason, keeping the first few distinct ones
+constexpr size_t jit_max_abort_sites = 8;
+
+struct JitAbortSite
+{
+    std::string location;
+    std::string reason;
+    uint64_t count = 0;
+};
+
+struct JitStats
+{
+    uint64_t traces = 0;
+    uint64_t aborts = 0;
+    uint64_t flushes = 0;
+    std::vector<JitAbortSite> abort_sites;
+
+    // Profiler samples by VM state, only collected for the script with jit.profile set.
+    // Host samples include time between callbacks, as the VM sits in C while idle.
+    bool profiling = false;
+    uint64_t samples_traced = 0;
+    uint64_t samples_interpreted = 0;
+    uint64_t samples_host = 0;
+    uint64_t samples_gc = 0;
+    uint64_t samples_compiler = 0;
+};
+
 struct Script
 {
     std::filesystem::path path;
+    ScriptArena arena;
     std::optional<sol::state> lua;
     std::vector<sol::function> callbacks;
     std::vector<VirtualJoystick*> vjoysticks;
+    std::vector<VirtualMouse*> vmice;
+    std::vector<VirtualKeyboard*> vkeyboards;
+    std::vector<InputDevice*> input_devices;
+    LogicGraph logic;
+    ChannelSet channels;
 
     bool disabled = true;
     std::string error;
 
+    // Scripts with required devices stay dormant, running no callbacks, until all are present
+    std::vector<ScriptDeviceRequirement> required_devices;
+    bool release_devices = true;
+    bool dormant = false;
+
+#if defined(MAPPER_TRACING)
+    // Interned file name labelling this script's trace spans
+    const char* trace_label = nullptr;
+#endif
+
+    // Opened on first use and kept across reloads, closed when the script is destroyed
+    PersistentStore* persistent = nullptr;
+
+    bool jit_enabled = true;
+    JitStats jit;
+
+    // Tears down the Lua state and all devices
+    void Release();
+
+    // Returns every output to neutral and reports it, for devices kept while dormant
+    void ResetOutputs();
     void Disable();
     void Destroy();
 };
 
+inline bool bytecode_cache_enabled = true;
+inline uint64_t bytecode_cache_hits = 0;
+inline uint64_t bytecode_cache_misses = 0;
+inline std::chrono::duration<double, std::nano> bytecode_cache_saved = {};
+
+sol::load_result LoadScriptChunk(sol::state& lua, const std::filesystem::path& path);
+
+// Hooks trace events for the script's JIT statistics, before any of its code runs
+void AttachJitDiagnostics(Script* script);
+// Applies the `jit` table of the script descriptor (off, hotloop, maxtrace, profile)
+void ConfigureJit(Script* script, const sol::table& table);
+void StopJitProfile(Script* script);
+
 inline std::vector<Script*> scripts;
 inline std::vector<Script*> scripts_delete_queue;
 
+// Source of VirtualJoystick::id, ids are never reused
+inline uint64_t next_vjoystick_id = 1;
+
 void QueueUnloadScript(Script* script);
 void FlushScriptDeleteQueue(SharedLockGuard&);
 void ReportScriptError(Script* script, const sol::error& error);
+bool RequiredDevicesPresent(Script* script);
+void UpdateScriptActivation();
 void LoadScript(Script* script);
-void LoadScript(const std::filesystem::path& script_path);
-
-// -----------------------------------------------------------------------------
-//          GUI
-// -----------------------------------------------------------------------------
-
-inline uint64_t gui_frame = 0;
-
-void OpenGUI();
-void PushGUIRedrawEvent();
-void CloseGUI();
+void UnloadAllScripts();
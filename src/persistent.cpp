@@ -0,0 +1,182 @@
+#include "mapper.hpp"
+
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+
+// -----------------------------------------------------------------------------
+
+static
+uint32_t PersistentChecksum(const PersistentSlot& slot)
+{
+    auto bytes = reinterpret_cast<const uint8_t*>(&slot);
+    uint32_t hash = 0x811c9dc5;
+    for (size_t i = offsetof(PersistentSlot, generation); i < sizeof(PersistentSlot); ++i) {
+        hash ^= bytes[i];
+        hash *= 0x01000193;
+    }
+    // Zero is reserved for slots that were never written
+    return hash ? hash : 1;
+}
+
+static
+bool IsSlotValid(const PersistentSlot& slot)
+{
+    return slot.checksum
+        && slot.key_length <= persistent_max_key
+        && slot.checksum == PersistentChecksum(slot);
+}
+
+static
+const std::filesystem::path& GetPersistentDir()
+{
+    static std::filesystem::path dir = [] {
+        std::filesystem::path path;
+        if (auto state_dir = std::getenv("MAPPER_STATE_DIR"); state_dir && *state_dir) {
+            path = state_dir;
+        } else {
+            auto pref_path = SDL_GetPrefPath("Mapper", "mapper");
+            if (!pref_path) {
+                Error("Could not locate persistent state directory: {}", SDL_GetError());
+            }
+            path = pref_path;
+            SDL_free(pref_path);
+            path /= "state";
+        }
+
+        std::error_code ec;
+        std::filesystem::create_directories(path, ec);
+        if (ec) {
+            Error("Could not create persistent state directory: {}", ec.message());
+        }
+
+        return path;
+    }();
+    return dir;
+}
+
+// -----------------------------------------------------------------------------
+
+PersistentStore* OpenPersistentStore(const std::filesystem::path& script_path)
+{
+    // One file per script, keyed on the script path
+    uint64_t hash = 0xcbf29ce484222325;
+    for (auto c : std::filesystem::absolute(script_path).string()) {
+        hash ^= uint8_t(c);
+        hash *= 0x100000001b3;
+    }
+
+    auto store = new PersistentStore;
+    store->path = GetPersistentDir() / std::format("{:016x}.state", hash);
+    store->file = MapPersistentFile(store->path);
+    store->current.resize(persistent_capacity);
+
+    auto* file = store->file;
+    if (std::memcmp(file->magic, persistent_magic, sizeof(persistent_magic)) != 0
+            || file->capacity != persistent_capacity
+            || file->slot_size != sizeof(PersistentSlot)) {
+        bool fresh = std::ranges::all_of(file->magic, [](char c) { return c == 0; });
+        if (!fresh) LogWarn("Persistent state [{}] has an incompatible layout, resetting", store->path.string());
+        std::memset(file, 0, sizeof(PersistentFile));
+        std::memcpy(file->magic, persistent_magic, sizeof(persistent_magic));
+        file->capacity = persistent_capacity;
+        file->slot_size = sizeof(PersistentSlot);
+        return store;
+    }
+
+    // Rebuild the index from the newest valid slot of each entry
+    uint32_t discarded = 0;
+    for (uint32_t i = 0; i < persistent_capacity; ++i) {
+        auto& entry = file->entries[i];
+        bool valid[2] = { IsSlotValid(entry.slots[0]), IsSlotValid(entry.slots[1]) };
+        if (!valid[0] && !valid[1]) {
+            discarded += entry.slots[0].checksum || entry.slots[1].checksum;
+            entry = {};
+            continue;
+        }
+
+        uint8_t current = !valid[0] || (valid[1] && entry.slots[1].generation > entry.slots[0].generation);
+        auto& slot = entry.slots[current];
+        store->current[i] = current;
+        store->index.emplace(std::string(slot.key, slot.key_length), i);
+    }
+
+    if (discarded) LogWarn("Discarded {} damaged entries from persistent state [{}]", discarded, store->path.string());
+
+    return store;
+}
+
+void ClosePersistentStore(PersistentStore* store)
+{
+    UnmapPersistentFile(store->file);
+    delete store;
+}
+
+PersistentValue PersistentStore::Get(std::string_view key)
+{
+    auto found = index.find(key);
+    if (found == index.end()) return {};
+
+    auto& slot = file->entries[found->second].slots[current[found->second]];
+    switch (slot.type) {
+        case PersistentType::Number:  return slot.number;
+        case PersistentType::Boolean: return slot.boolean;
+        case PersistentType::String:  return std::string_view(slot.string, slot.value_length);
+        default:                      return {};
+    }
+}
+
+void PersistentStore::Set(std::string_view key, const PersistentValue& value)
+{
+    if (key.size() > persistent_max_key) {
+        Error("Persistent key too long: {} (max {} bytes)", key, persistent_max_key);
+    }
+    if (auto str = std::get_if<std::string_view>(&value); str && str->size() > persistent_max_string) {
+        Error("Persistent string too long for key {} (max {} bytes)", key, persistent_max_string);
+    }
+
+    auto found = index.find(key);
+    if (found == index.end()) {
+        if (std::holds_alternative<std::monostate>(value)) return;
+
+        // Entries are never removed, claim the first that has never been written. The index can
+        // hold fewer keys than there are used entries if the file contains duplicate keys
+        uint32_t i = 0;
+        while (i < persistent_capacity && (file->entries[i].slots[0].checksum || file->entries[i].slots[1].checksum)) ++i;
+        if (i == persistent_capacity) {
+            Error("Persistent state full ({} keys)", persistent_capacity);
+        }
+        found = index.emplace(std::string(key), i).first;
+        current[i] = 1;
+    }
+
+    auto i = found->second;
+    auto& entry = file->entries[i];
+    auto& previous = entry.slots[current[i]];
+    auto& slot = entry.slots[!current[i]];
+
+    // Invalidate the slot before touching its contents, then publish it with the checksum stored last
+    std::atomic_ref(slot.checksum).store(0, std::memory_order_relaxed);
+    std::atomic_signal_fence(std::memory_order_release);
+
+    std::memset(reinterpret_cast<char*>(&slot) + sizeof(slot.checksum), 0, sizeof(PersistentSlot) - sizeof(slot.checksum));
+    slot.generation = previous.checksum ? previous.generation + 1 : 1;
+    slot.key_length = uint8_t(key.size());
+    std::memcpy(slot.key, key.data(), key.size());
+    if (auto number = std::get_if<double>(&value)) {
+        slot.type = PersistentType::Number;
+        slot.number = *number;
+    } else if (auto boolean = std::get_if<bool>(&value)) {
+        slot.type = PersistentType::Boolean;
+        slot.boolean = *boolean;
+    } else if (auto str = std::get_if<std::string_view>(&value)) {
+        slot.type = PersistentType::String;
+        slot.value_length = uint8_t(str->size());
+        std::memcpy(slot.string, str->data(), str->size());
+    } else {
+        slot.type = PersistentType::Nil;
+    }
+
+    std::atomic_ref(slot.checksum).store(PersistentChecksum(slot), std::memory_order_release);
+    current[i] = !current[i];
+}
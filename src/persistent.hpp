@@ -0,0 +1,97 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <variant>
+#include <vector>
+
+// -----------------------------------------------------------------------------
+//          Persistent State
+// -----------------------------------------------------------------------------
+
+// Per-script key value store backed by a memory mapped file, so values survive
+// script reloads and restarts while reads and writes are plain memory accesses.
+//
+// Every entry has two slots. A write fills the inactive slot and stores its
+// checksum last, so a crash mid-write leaves the previous value intact. On open
+// the valid slot with the highest generation wins.
+
+constexpr char persistent_magic[8] = "MAPRKV1";
+constexpr uint32_t persistent_capacity = 512;
+constexpr uint32_t persistent_max_key = 28;
+constexpr uint32_t persistent_max_string = 24;
+
+enum class PersistentType : uint8_t
+{
+    Nil,
+    Number,
+    Boolean,
+    String,
+};
+
+struct PersistentSlot
+{
+    // FNV-1a of the rest of the slot, 0 = never written
+    uint32_t checksum;
+    uint32_t generation;
+
+    PersistentType type;
+    uint8_t key_length;
+    uint8_t value_length;
+    uint8_t reserved;
+    char key[persistent_max_key];
+
+    union {
+        double number;
+        bool boolean;
+        char string[persistent_max_string];
+    };
+};
+
+static_assert(sizeof(PersistentSlot) == 64);
+
+struct PersistentEntry
+{
+    PersistentSlot slots[2];
+};
+
+struct PersistentFile
+{
+    char magic[8];
+    uint32_t capacity;
+    uint32_t slot_size;
+    char reserved[48];
+
+    PersistentEntry entries[persistent_capacity];
+};
+
+struct PersistentKeyHash
+{
+    using is_transparent = void;
+    size_t operator()(std::string_view key) const { return std::hash<std::string_view>{}(key); }
+};
+
+using PersistentValue = std::variant<std::monostate, double, bool, std::string_view>;
+
+struct PersistentStore
+{
+    PersistentFile* file = nullptr;
+    std::filesystem::path path;
+
+    // Key to entry index, and the current slot of each entry
+    std::unordered_map<std::string, uint32_t, PersistentKeyHash, std::equal_to<>> index;
+    std::vector<uint8_t> current;
+
+    PersistentValue Get(std::string_view key);
+    void Set(std::string_view key, const PersistentValue& value);
+};
+
+PersistentStore* OpenPersistentStore(const std::filesystem::path& script_path);
+void ClosePersistentStore(PersistentStore* store);
+
+// Platform
+PersistentFile* MapPersistentFile(const std::filesystem::path& path);
+void UnmapPersistentFile(PersistentFile* file);
@@ -1,20 +1,74 @@
 #include "mapper.hpp"
 
-void Script::Disable()
+void Script::Release()
 {
+    MAPPER_TRACE_SPAN("Script Release");
+
+    noise_gates.RemoveOwner(this);
+    logic.Clear();
+    channels.Clear();
     for (auto& joystick : vjoysticks) {
         joystick->Destroy();
     }
     vjoysticks.clear();
+    for (auto* mouse : vmice) {
+        mouse->Destroy();
+    }
+    vmice.clear();
+    for (auto* keyboard : vkeyboards) {
+        keyboard->Destroy();
+    }
+    vkeyboards.clear();
+    for (auto* device : input_devices) {
+        device->Destroy();
+    }
+    input_devices.clear();
     callbacks.clear();
-    lua = std::nullopt;
+    if (lua) {
+        StopJitProfile(this);
+        // Skip per-object frees during lua_close, the arena is released in bulk
+        arena.releasing = true;
+        lua = std::nullopt;
+    }
+    arena.Release();
+}
+
+void Script::ResetOutputs()
+{
+    auto now = std::chrono::steady_clock::now();
 
+    for (auto* vjoy : vjoysticks) {
+        for (uint32_t i = 0; i < vjoy->num_axes; ++i) vjoy->SetAxis(i, 0.f);
+        for (uint32_t i = 0; i < vjoy->num_buttons; ++i) vjoy->SetButton(i, false);
+        // Bypass pacing, nothing presents this device again until the script wakes
+        vjoy->next_report = {};
+        vjoy->Present(now);
+    }
+    for (auto* mouse : vmice) {
+        mouse->SetVelocity(0.f, 0.f);
+        mouse->SetWheelVelocity(0.f, 0.f);
+        mouse->delta_x = mouse->delta_y = mouse->delta_wheel = mouse->delta_hwheel = 0;
+        for (uint32_t i = 0; i < max_mouse_button_count; ++i) mouse->SetButton(i, false);
+        mouse->Present(now);
+    }
+    for (auto* keyboard : vkeyboards) {
+        if (keyboard->keys.none()) continue;
+        keyboard->keys.reset();
+        keyboard->dirty = true;
+        keyboard->Present();
+    }
+}
+
+void Script::Disable()
+{
+    Release();
     disabled = true;
 }
 
 void Script::Destroy()
 {
     Disable();
+    if (persistent) ClosePersistentStore(persistent);
     delete this;
 }
 
@@ -43,13 +97,102 @@ void ReportScriptError(Script* script, const sol::error& error)
     script->error = error.what();
 }
 
+static
+uint16_t ToKeyCode(const sol::object& key)
+{
+    if (key.is<std::string>()) {
+        auto name = key.as<std::string>();
+        auto code = KeyCodeFromName(name);
+        if (!code) Error("Unknown key: {}", name);
+        return *code;
+    }
+    auto code = key.as<uint16_t>();
+    if (code > max_key_code) Error("Key code out of range: {}", code);
+    return code;
+}
+
+bool RequiredDevicesPresent(Script* script)
+{
+    return std::ranges::all_of(script->required_devices, [](const ScriptDeviceRequirement& required) {
+        return std::ranges::any_of(joysticks, [&](SDL_Joystick* joystick) {
+            return SDL_GetJoystickVendor(joystick) == required.vendor_id
+                && SDL_GetJoystickProduct(joystick) == required.product_id;
+        });
+    });
+}
+
+void UpdateScriptActivation()
+{
+    for (auto* script : scripts) {
+        if (script->disabled || script->required_devices.empty()) continue;
+
+        bool present = RequiredDevicesPresent(script);
+        if (script->dormant && present) {
+            Log("Required devices present, activating [{}]", script->path.string());
+            if (script->lua) script->dormant = false;
+            else LoadScript(script);
+        } else if (!script->dormant && !present) {
+            Log("Required devices removed, deactivating [{}]", script->path.string());
+            script->dormant = true;
+            if (script->release_devices) script->Release();
+            else                         script->ResetOutputs();
+        }
+    }
+}
+
+static
+std::chrono::steady_clock::duration SecondsToDuration(double seconds)
+{
+    return std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(seconds));
+}
+
 void LoadScript(Script* script)
 {
+    // Virtual joysticks released here are pooled and handed back as the script recreates them
+    auto previous_vjoysticks = script->vjoysticks;
+
     script->Disable();
 
-    auto& lua = script->lua.emplace();
+    script->required_devices.clear();
+    script->release_devices = true;
+    script->dormant = false;
+
+#if defined(MAPPER_TRACING)
+    script->trace_label = InternTraceName(script->path.filename().string());
+#endif
+
+    script->arena.limit.Set(script_memory_limit);
+    script->arena.peak.Set(0);
+    script->arena.failed_allocations.Set(0);
+
+    auto& lua = script->lua.emplace(sol::default_at_panic, &ScriptArena::LuaAlloc, &script->arena);
+
+    lua.open_libraries(sol::lib::base, sol::lib::math, sol::lib::jit);
+    AttachJitDiagnostics(script);
+
+    // Route print through the logger, so that chatty scripts can't stall the engine on stdout
+    lua.set_function("print", [name = script->path.filename().string()](sol::this_state ts, sol::variadic_args args) {
+        std::array<char, 1024> buffer;
+        size_t length = 0;
+        for (auto arg : args) {
+            size_t str_len;
+            auto str = luaL_tolstring(ts, arg.stack_index(), &str_len);
+            if (length && length < buffer.size()) buffer[length++] = '\t';
+            auto count = std::min(str_len, buffer.size() - length);
+            std::copy_n(str, count, buffer.data() + length);
+            length += count;
+            lua_pop(ts, 1);
+        }
+        Log("[{}] {}", name, std::string_view(buffer.data(), length));
+    });
+
+    struct LuaJoystick {
+        SDL_Joystick* joystick;
+    };
 
-    lua.open_libraries(sol::lib::base, sol::lib::math);
+    struct LuaChannel {
+        AxisChannel* channel;
+    };
 
     struct LuaVirtualJoystick {
         VirtualJoystick* joystick;
@@ -57,7 +200,18 @@ void LoadScript(Script* script)
 
     lua.new_usertype<LuaVirtualJoystick>("VirtualJoystick",
         "SetAxis",   [](LuaVirtualJoystick& self, uint32_t i, float v) { self.joystick->SetAxis(i, v); },
-        "SetButton", [](LuaVirtualJoystick& self, uint32_t i, bool v) { self.joystick->SetButton(i, v); });
+        "SetButton", [](LuaVirtualJoystick& self, uint32_t i, bool v) { self.joystick->SetButton(i, v); },
+        "RouteForceFeedback", [](LuaVirtualJoystick& self, const sol::table& table) {
+            ForceFeedbackRoute route {
+                .scale       = table["scale"].get_or(1.f),
+                .swap_motors = table["swap_motors"].get_or(false),
+                .drop        = table["drop"].get_or(false),
+            };
+            if (auto target = table["target"].get<std::optional<LuaJoystick>>()) {
+                route.target = SDL_GetJoystickID(target->joystick);
+            }
+            SetForceFeedbackRoute(self.joystick, route);
+        });
 
     lua.set_function("CreateVirtualJoystick", [script](const sol::table& table) -> LuaVirtualJoystick {
         auto vjoy = CreateVirtualJoystick({
@@ -68,22 +222,238 @@ void LoadScript(Script* script)
             .product_id  = table["product_id"].get_or<uint16_t>(0),
             .num_axes    = table["num_axes"].get_or<uint16_t>(0),
             .num_buttons = table["num_buttons"].get_or<uint16_t>(0),
+            .max_report_rate = table["max_report_rate"].get_or(0.f),
+            .flush_on_button = table["flush_on_button"].get_or(true),
+            .force_feedback  = table["force_feedback"].get_or(false),
         });
+        if (!vjoy->id) vjoy->id = next_vjoystick_id++;
+#if defined(MAPPER_TRACING)
+        vjoy->trace_label = InternTraceName(vjoy->name);
+#endif
         script->vjoysticks.emplace_back(vjoy);
         return {vjoy};
     });
 
+    struct LuaVirtualMouse {
+        VirtualMouse* mouse;
+    };
+
+    lua.new_usertype<LuaVirtualMouse>("VirtualMouse",
+        "SetVelocity",      [](LuaVirtualMouse& self, float x, float y) { self.mouse->SetVelocity(x, y); },
+        "SetWheelVelocity", [](LuaVirtualMouse& self, float v, sol::optional<float> h) { self.mouse->SetWheelVelocity(v, h.value_or(0.f)); },
+        "Move",             [](LuaVirtualMouse& self, int32_t x, int32_t y) { self.mouse->Move(x, y); },
+        "SetButton",        [](LuaVirtualMouse& self, uint32_t i, bool v) { self.mouse->SetButton(i, v); });
+
+    lua.set_function("CreateVirtualMouse", [script](const sol::table& table) -> LuaVirtualMouse {
+        auto mouse = CreateVirtualMouse({
+            .name       = table["name"].get<std::string>(),
+            .version    = table["version"].get_or<uint16_t>(0),
+            .vendor_id  = table["vendor_id"].get_or<uint16_t>(0),
+            .product_id = table["product_id"].get_or<uint16_t>(0),
+            .tick_rate  = table["tick_rate"].get_or(1000.f),
+        });
+#if defined(MAPPER_TRACING)
+        mouse->trace_label = InternTraceName(mouse->name);
+#endif
+        script->vmice.emplace_back(mouse);
+        return {mouse};
+    });
+
+    struct LuaVirtualKeyboard {
+        VirtualKeyboard* keyboard;
+    };
+
+    lua.new_usertype<LuaVirtualKeyboard>("VirtualKeyboard",
+        "SetKey", [](LuaVirtualKeyboard& self, const sol::object& key, bool v) {
+            auto code = ToKeyCode(key);
+            if (!IsKeyboardKeyCode(code)) Error("Key code {} is a button, not available on a virtual keyboard", code);
+            self.keyboard->SetKey(code, v);
+        },
+        "GetKey", [](LuaVirtualKeyboard& self, const sol::object& key) { return self.keyboard->GetKey(ToKeyCode(key)); });
+
+    lua.set_function("CreateVirtualKeyboard", [script](const sol::table& table) -> LuaVirtualKeyboard {
+        auto keyboard = CreateVirtualKeyboard({
+            .name       = table["name"].get<std::string>(),
+            .version    = table["version"].get_or<uint16_t>(0),
+            .vendor_id  = table["vendor_id"].get_or<uint16_t>(0),
+            .product_id = table["product_id"].get_or<uint16_t>(0),
+        });
+#if defined(MAPPER_TRACING)
+        keyboard->trace_label = InternTraceName(keyboard->name);
+#endif
+        script->vkeyboards.emplace_back(keyboard);
+        return {keyboard};
+    });
+
+    struct LuaInputDevice {
+        InputDevice* device;
+    };
+
+    lua.new_usertype<LuaInputDevice>("InputDevice",
+        "GetKey",      [](LuaInputDevice& self, const sol::object& key) { return bool(self.device->state.keys[ToKeyCode(key)]); },
+        "WasPressed",  [](LuaInputDevice& self, const sol::object& key) { return bool(self.device->state.pressed[ToKeyCode(key)]); },
+        "GetButton",   [](LuaInputDevice& self, uint32_t i) { return i < max_mouse_button_count && self.device->state.keys[mouse_button_base_code + i]; },
+        "GetRelative", [](LuaInputDevice& self) { return std::make_tuple(self.device->state.rel_x, self.device->state.rel_y); },
+        "GetWheel",    [](LuaInputDevice& self) { return std::make_tuple(self.device->state.wheel, self.device->state.hwheel); },
+        "Key",         [](LuaInputDevice& self, const sol::object& key) {
+            return LogicInput{ .source = LogicSource::DeviceKey, .device = uint64_t(uintptr_t(self.device)), .index = ToKeyCode(key) };
+        });
+
+    lua.set_function("OpenInputDevice", [script](const sol::table& table) -> LuaInputDevice {
+        auto device = OpenInputDevice({
+            .path = table["path"].get<std::string>(),
+            .grab = table["grab"].get_or(false),
+            .loop = table["loop"].get_or(false),
+        });
+        script->input_devices.emplace_back(device);
+        return {device};
+    });
+
+    // Scripts can only tighten the limit configured on the command line
+    lua.set_function("SetMemoryLimit", [script](size_t bytes) {
+        if (script_memory_limit && (!bytes || bytes > script_memory_limit)) {
+            LogWarn("Memory limit of {} for [{}] exceeds the configured limit, clamping to {}",
+                bytes ? BytesToString(bytes) : "unlimited", script->path.string(), BytesToString(script_memory_limit));
+            bytes = script_memory_limit;
+        }
+        script->arena.limit.Set(bytes);
+    });
+
     lua.set_function("GetTime", []() -> double {
         return SDL_GetTicks() / 1000.0;
     });
 
-    struct LuaJoystick {
-        SDL_Joystick* joystick;
+    lua.new_usertype<LuaJoystick>("Joystick",
+        "GetAxis",   [](LuaJoystick& self, uint32_t i) {
+            return FromSNorm(noise_gates.Read(SDL_GetJoystickID(self.joystick), uint8_t(i), SDL_GetJoystickAxis(self.joystick, i)));
+        },
+        "GetButton", [](LuaJoystick& self, uint32_t i) { return SDL_GetJoystickButton(self.joystick, i); },
+        "Button",    [](LuaJoystick& self, uint32_t i) {
+            return LogicInput{ .source = LogicSource::JoystickButton, .device = SDL_GetJoystickID(self.joystick), .index = i };
+        },
+        "Channel",   [script](LuaJoystick& self, uint8_t i) {
+            auto id = SDL_GetJoystickID(self.joystick);
+            return LuaChannel{ script->channels.Get(id, i, FromSNorm(noise_gates.Read(id, i, SDL_GetJoystickAxis(self.joystick, i)))) };
+        },
+        "SetNoiseGate", [script](LuaJoystick& self, const sol::table& table) {
+            auto axis = table["axis"].get<std::optional<uint8_t>>();
+            noise_gates.Set(SDL_GetJoystickID(self.joystick), axis ? *axis : NoiseGates::any_axis, {
+                .threshold = table["threshold"].get_or(0),
+                .offset    = table["offset"].get_or(0),
+                .owner     = script,
+            });
+        });
+
+    lua.new_usertype<LuaChannel>("Channel",
+        "Get",    [](LuaChannel& self) { return self.channel->value; },
+        "Count",  [](LuaChannel& self) { return self.channel->batch.size(); },
+        "Sample", [](LuaChannel& self, size_t i) {
+            if (i < 1 || i > self.channel->batch.size()) Error("Sample index out of range: {}", i);
+            auto& sample = self.channel->batch[i - 1];
+            return std::make_tuple(sample.value, double(sample.time_ns) * 1e-9);
+        });
+
+    struct LuaFilter {
+        AxisFilter* filter;
     };
 
-    lua.new_usertype<LuaJoystick>("Joystick",
-        "GetAxis",   [](LuaJoystick& self, uint32_t i) { return FromSNorm(SDL_GetJoystickAxis(self.joystick, i)); },
-        "GetButton", [](LuaJoystick& self, uint32_t i) { return SDL_GetJoystickButton(self.joystick, i); });
+    lua.new_usertype<LuaFilter>("Filter",
+        "Get", [](LuaFilter& self) { return self.filter->value; });
+
+    auto add_filter = [script](const sol::table& table, AxisFilter filter) -> LuaFilter {
+        auto input = table.get<std::optional<LuaChannel>>("input");
+        if (!input) Error("Filter requires an input channel");
+        return { script->channels.AddFilter(input->channel, filter) };
+    };
+
+    lua.set_function("OneEuroFilter", [add_filter](const sol::table& table) {
+        return add_filter(table, {
+            .type       = FilterType::OneEuro,
+            .min_cutoff = table["min_cutoff"].get_or(1.f),
+            .beta       = table["beta"].get_or(0.f),
+            .d_cutoff   = table["d_cutoff"].get_or(1.f),
+        });
+    });
+
+    lua.set_function("EMAFilter", [add_filter](const sol::table& table) {
+        return add_filter(table, { .type = FilterType::EMA, .time_constant = table["time_constant"].get_or(0.05f) });
+    });
+
+    lua.set_function("SlewFilter", [add_filter](const sol::table& table) {
+        return add_filter(table, { .type = FilterType::Slew, .rate = table["rate"].get_or(10.f) });
+    });
+
+    lua.set_function("MedianFilter", [add_filter](const sol::table& table) {
+        return add_filter(table, { .type = FilterType::Median, .window = table["window"].get_or(3u) });
+    });
+
+    struct LuaLogic {
+        LogicPrimitive* primitive;
+    };
+
+    lua.new_usertype<LogicInput>("LogicInput", sol::no_constructor);
+
+    lua.new_usertype<LuaLogic>("Logic",
+        "Get",          [](LuaLogic& self) { return self.primitive->output; },
+        "GetLayer",     [](LuaLogic& self) { return self.primitive->layer; },
+        "IsShifted",    [](LuaLogic& self) { return self.primitive->shifted; },
+        "IsLongPress",  [](LuaLogic& self) { return self.primitive->output; },
+        "WasTap",       [](LuaLogic& self) { return self.primitive->tapped; },
+        "WasDoubleTap", [](LuaLogic& self) { return self.primitive->double_tapped; });
+
+    // Inputs are joystick:Button(i), device:Key(name) or another primitive
+    auto to_input = [](const sol::object& object) -> LogicInput {
+        if (object.is<LogicInput>()) return object.as<LogicInput>();
+        if (object.is<LuaLogic>()) return { .source = LogicSource::Primitive, .device = uint64_t(uintptr_t(object.as<LuaLogic>().primitive)) };
+        Error("Expected a button, key or logic primitive");
+        return {};
+    };
+
+    auto to_inputs = [to_input](const sol::table& table) {
+        std::vector<LogicInput> inputs;
+        for (size_t i = 1; i <= table.size(); ++i) {
+            inputs.push_back(to_input(table.get<sol::object>(i)));
+        }
+        return inputs;
+    };
+
+    lua.set_function("Toggle", [script, to_input](const sol::table& table) -> LuaLogic {
+        return { script->logic.Create({
+            .type   = LogicType::Toggle,
+            .inputs = { to_input(table.get<sol::object>("input")) },
+        })};
+    });
+
+    lua.set_function("Chord", [script, to_inputs](const sol::table& table) -> LuaLogic {
+        return { script->logic.Create({
+            .type   = LogicType::Chord,
+            .inputs = to_inputs(table),
+        })};
+    });
+
+    lua.set_function("Layer", [script, to_inputs](const sol::table& table) -> LuaLogic {
+        return { script->logic.Create({
+            .type   = LogicType::Layer,
+            .inputs = to_inputs(table),
+            .latch  = table["latch"].get_or(false),
+        })};
+    });
+
+    lua.set_function("PressDetector", [script, to_input](const sol::table& table) -> LuaLogic {
+        return { script->logic.Create({
+            .type       = LogicType::PressDetector,
+            .inputs     = { to_input(table.get<sol::object>("input")) },
+            .long_press = SecondsToDuration(table["long_press"].get_or(0.5)),
+            .double_tap = SecondsToDuration(table["double_tap"].get_or(0.25)),
+        })};
+    });
+
+    lua.set_function("Shift", [script, to_input](const sol::table& table) -> LuaLogic {
+        return { script->logic.Create({
+            .type   = LogicType::Shift,
+            .inputs = { to_input(table.get<sol::object>("modifier")), to_input(table.get<sol::object>("input")) },
+        })};
+    });
 
     lua.set_function("FindJoystick", [&](uint16_t vendor_id, uint16_t product_id) -> std::optional<LuaJoystick> {
         for (auto joystick : joysticks) {
@@ -96,33 +466,124 @@ void LoadScript(Script* script)
         return std::nullopt;
     });
 
+    lua.set_function("Configure", [script](const sol::table& table) {
+        script->release_devices = table["release_devices"].get_or(true);
+        if (auto jit = table["jit"].get<std::optional<sol::table>>()) {
+            ConfigureJit(script, *jit);
+        }
+        if (auto required = table["requires"].get<std::optional<sol::table>>()) {
+            for (auto& [_, entry] : *required) {
+                auto device = entry.as<sol::table>();
+                script->required_devices.push_back({
+                    .vendor_id  = device["vendor_id"].get<uint16_t>(),
+                    .product_id = device["product_id"].get<uint16_t>(),
+                });
+            }
+        }
+
+        script->dormant = !RequiredDevicesPresent(script);
+
+        // Stop before the script creates any devices, it will be run again once the devices appear
+        if (script->dormant && script->release_devices) {
+            throw std::runtime_error("Required devices not present");
+        }
+    });
+
+    struct LuaPersistentStore {
+        PersistentStore* store;
+    };
+
+    lua.new_usertype<LuaPersistentStore>("PersistentStore", sol::no_constructor,
+        sol::meta_function::index, [](LuaPersistentStore& self, std::string_view key, sol::this_state ts) -> sol::object {
+            auto value = self.store->Get(key);
+            if (auto number = std::get_if<double>(&value))          return sol::make_object(ts, *number);
+            if (auto boolean = std::get_if<bool>(&value))           return sol::make_object(ts, *boolean);
+            if (auto str = std::get_if<std::string_view>(&value))   return sol::make_object(ts, *str);
+            return sol::lua_nil;
+        },
+        sol::meta_function::new_index, [](LuaPersistentStore& self, std::string_view key, const sol::object& value) {
+            switch (value.get_type()) {
+                case sol::type::lua_nil: self.store->Set(key, {}); break;
+                case sol::type::number:  self.store->Set(key, value.as<double>()); break;
+                case sol::type::boolean: self.store->Set(key, value.as<bool>()); break;
+                case sol::type::string:  self.store->Set(key, value.as<std::string_view>()); break;
+                default: Error("Persistent values must be numbers, booleans or strings: {}", key);
+            }
+        });
+
+    lua.set_function("PersistentState", [script]() -> LuaPersistentStore {
+        if (!script->persistent) script->persistent = OpenPersistentStore(script->path);
+        return {script->persistent};
+    });
+
     lua.set_function("Register", [script](sol::function f) {
         script->callbacks.emplace_back(std::move(f));
     });
 
+    MAPPER_TRACE_SPAN("Script Load", script->trace_label);
+
     try {
-        lua.script_file(script->path.string());
+        auto chunk = LoadScriptChunk(lua, script->path);
+        if (!chunk.valid()) throw chunk.get<sol::error>();
+        sol::protected_function main = chunk;
+        auto res = main();
+        if (!res.valid()) throw res.get<sol::error>();
         script->disabled = false;
+
+        // Devices the script no longer creates, such as ones whose description was edited, are not kept around
+        for (auto* vjoy : previous_vjoysticks) {
+            if (std::ranges::find(script->vjoysticks, vjoy) == script->vjoysticks.end()) DestroyPooledVirtualJoystick(vjoy);
+        }
     } catch (const sol::error& e) {
+        if (script->dormant && script->release_devices) {
+            Log("Script [{}] dormant until required devices are present", script->path.string());
+            script->Release();
+            script->disabled = false;
+            return;
+        }
         ReportScriptError(script, e);
         script->Disable();
     }
 }
 
-static
 void UnloadScript(const std::filesystem::path& script_path)
 {
     Log("Unloading [{}]", script_path.string());
     std::erase_if(scripts, [&](auto& script) {
         Log(" - [{}]: {}", script->path.string(), script->path == script_path);
         if (script->path != script_path) return false;
+
+        // Explicit unloads remove the devices from the game straight away
+        auto vjoysticks = script->vjoysticks;
         script->Destroy();
+        for (auto* vjoy : vjoysticks) {
+            DestroyPooledVirtualJoystick(vjoy);
+        }
         return true;
     });
 }
 
+void UnloadAllScripts()
+{
+    SharedLockGuard _{ engine_mutex, LockState::Unique };
+
+    // Scripts queued for deletion are still in the list
+    for (auto* script : scripts) {
+        script->Destroy();
+    }
+    scripts.clear();
+    scripts_delete_queue.clear();
+}
+
 void LoadScript(const std::filesystem::path& script_path)
 {
+    // Loading a script that is already loaded reloads it in place, so it gets its devices back
+    for (auto* script : scripts) {
+        if (script->path != script_path || std::ranges::find(scripts_delete_queue, script) != scripts_delete_queue.end()) continue;
+        LoadScript(script);
+        return;
+    }
+
     UnloadScript(script_path);
 
     auto script = new Script{script_path};
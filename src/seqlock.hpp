@@ -0,0 +1,41 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+
+// Single writer, multiple reader sequence lock. Readers never block the writer
+// and retry if they observe a write in progress. Suitable for shared memory.
+
+template<typename T>
+struct SeqLocked
+{
+    static_assert(std::is_trivially_copyable_v<T>);
+
+    std::atomic<uint64_t> sequence = 0;
+    T value;
+
+    template<typename Fn>
+    void Write(Fn&& fn)
+    {
+        auto seq = sequence.load(std::memory_order_relaxed);
+        sequence.store(seq + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        fn(value);
+        sequence.store(seq + 2, std::memory_order_release);
+    }
+
+    // Returns the sequence of the copied value, or 0 if a consistent copy could not be taken
+    uint64_t TryRead(T& out, uint32_t max_attempts = 64) const
+    {
+        for (uint32_t i = 0; i < max_attempts; ++i) {
+            auto before = sequence.load(std::memory_order_acquire);
+            if (before & 1) continue;
+            std::memcpy(&out, &value, sizeof(T));
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (sequence.load(std::memory_order_relaxed) == before) return before;
+        }
+        return 0;
+    }
+};
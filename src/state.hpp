@@ -0,0 +1,347 @@
+#pragma once
+
+#include "seqlock.hpp"
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <string_view>
+#include <algorithm>
+
+// -----------------------------------------------------------------------------
+//          Engine State
+// -----------------------------------------------------------------------------
+
+// Plain data snapshot of the engine published for the GUI, either in-process
+// or through shared memory when running as a daemon. All containers are
+// fixed size so that the snapshot can be copied as a single block.
+
+constexpr uint32_t state_region_magic = 0x5250414D; // "MAPR"
+constexpr uint32_t state_region_version = 10;
+
+constexpr uint32_t state_max_scripts = 32;
+constexpr uint32_t state_max_joysticks = 16;
+constexpr uint32_t state_max_vjoysticks = 32;
+constexpr uint32_t state_max_vdevices = 16;
+constexpr uint32_t state_max_input_devices = 16;
+constexpr uint32_t state_max_jit_aborts = 8;
+constexpr uint32_t state_max_gated_axes = 32;
+
+constexpr uint32_t state_max_joystick_axes = 16;
+constexpr uint32_t state_max_joystick_buttons = 128;
+constexpr uint32_t state_max_joystick_hats = 4;
+constexpr uint32_t state_max_vjoystick_axes = 19;
+constexpr uint32_t state_max_vjoystick_buttons = 128;
+
+template<size_t N>
+struct StateString
+{
+    std::array<char, N> data;
+
+    void Set(std::string_view str)
+    {
+        auto len = std::min(str.size(), N - 1);
+        std::copy_n(str.data(), len, data.data());
+        data[len] = '\0';
+    }
+
+    const char* c_str() const { return data.data(); }
+};
+
+struct JitAbortState
+{
+    StateString<128> location;
+    StateString<128> reason;
+    uint64_t count;
+};
+
+struct ScriptState
+{
+    StateString<256> path;
+    StateString<1024> error;
+    bool disabled;
+    bool dormant;
+
+    uint64_t memory_live;
+    uint64_t memory_peak;
+    uint64_t memory_reserved;
+    uint64_t memory_limit;
+    uint64_t failed_allocations;
+
+    bool jit_enabled;
+    uint64_t jit_traces;
+    uint64_t jit_aborts;
+    uint64_t jit_flushes;
+    uint32_t num_jit_abort_sites;
+    std::array<JitAbortState, state_max_jit_aborts> jit_abort_sites;
+
+    bool jit_profiling;
+    uint64_t jit_samples_traced;
+    uint64_t jit_samples_interpreted;
+    uint64_t jit_samples_host;
+    uint64_t jit_samples_gc;
+    uint64_t jit_samples_compiler;
+};
+
+struct JoystickState
+{
+    // SDL_JoystickID
+    uint32_t id;
+
+    StateString<128> name;
+    uint16_t bus_type;
+    uint16_t vendor_id;
+    uint16_t product_id;
+    uint16_t version;
+
+    uint32_t num_axes;
+    uint32_t num_buttons;
+    uint32_t num_hats;
+    std::array<int16_t, state_max_joystick_axes> axes;
+    std::array<bool, state_max_joystick_buttons> buttons;
+    std::array<uint8_t, state_max_joystick_hats> hats;
+};
+
+struct VirtualJoystickState
+{
+    // VirtualJoystick::id, used to address commands to this joystick
+    uint64_t id;
+
+    StateString<128> name;
+    uint32_t num_axes;
+    uint32_t num_buttons;
+    std::array<float, state_max_vjoystick_axes> axes;
+    std::array<bool, state_max_vjoystick_buttons> buttons;
+
+    uint64_t reports_emitted;
+    uint64_t reports_coalesced;
+
+    bool force_feedback;
+    uint64_t ff_uploads;
+    uint64_t ff_plays;
+    uint64_t ff_dropped;
+    int64_t ff_round_trip_ns;
+};
+
+struct VirtualMouseState
+{
+    StateString<128> name;
+    float velocity_x;
+    float velocity_y;
+    uint64_t reports_emitted;
+};
+
+struct VirtualKeyboardState
+{
+    StateString<128> name;
+    uint32_t keys_held;
+    uint64_t reports_emitted;
+};
+
+struct InputDeviceStateSnapshot
+{
+    StateString<128> name;
+    bool grab;
+    uint64_t events_received;
+    uint64_t frames;
+    uint32_t keys_held;
+    int32_t rel_x;
+    int32_t rel_y;
+    int32_t wheel;
+    int32_t hwheel;
+};
+
+// Lock statistics are only captured when built with MAPPER_LOCK_STATS, see lock.hpp
+constexpr uint32_t state_max_lock_sites = 32;
+constexpr uint32_t state_lock_histogram_buckets = 20;
+
+struct LockTimeState
+{
+    uint64_t total_ns;
+    uint64_t max_ns;
+    std::array<uint64_t, state_lock_histogram_buckets> histogram;
+};
+
+struct LockModeState
+{
+    uint64_t acquisitions;
+    LockTimeState wait;
+    LockTimeState hold;
+};
+
+struct LockSiteState
+{
+    StateString<128> file;
+    uint32_t line;
+
+    // Shared, Unique
+    std::array<LockModeState, 2> modes;
+};
+
+// Published separately from EngineState so builds without lock statistics never copy it
+struct LockStatsState
+{
+    bool enabled;
+    uint32_t num_sites;
+    std::array<LockSiteState, state_max_lock_sites> sites;
+};
+
+struct GatedAxisState
+{
+    // SDL_JoystickID
+    uint32_t joystick;
+    uint32_t axis;
+
+    uint64_t raw_events;
+    uint64_t gated_events;
+};
+
+struct EngineStats
+{
+    uint64_t frame;
+    int64_t average_script_ns;
+    double average_script_util;
+    uint64_t script_memory;
+
+    uint64_t bytecode_cache_hits;
+    uint64_t bytecode_cache_misses;
+    int64_t bytecode_cache_saved_ns;
+
+    uint64_t axis_events_raw;
+    uint64_t axis_events_gated;
+};
+
+struct EngineState
+{
+    EngineStats stats;
+
+    uint32_t num_scripts;
+    uint32_t num_joysticks;
+    uint32_t num_vjoysticks;
+    uint32_t num_vmice;
+    uint32_t num_vkeyboards;
+    uint32_t num_input_devices;
+    uint32_t num_gated_axes;
+
+    std::array<ScriptState, state_max_scripts> scripts;
+    std::array<JoystickState, state_max_joysticks> joysticks;
+    std::array<VirtualJoystickState, state_max_vjoysticks> vjoysticks;
+    std::array<VirtualMouseState, state_max_vdevices> vmice;
+    std::array<VirtualKeyboardState, state_max_vdevices> vkeyboards;
+    std::array<InputDeviceStateSnapshot, state_max_input_devices> input_devices;
+    std::array<GatedAxisState, state_max_gated_axes> gated_axes;
+};
+
+// -----------------------------------------------------------------------------
+//          Plot Channels
+// -----------------------------------------------------------------------------
+
+// The reader selects up to `state_max_plot_channels` values to plot, and the
+// engine pushes timestamped samples per channel into a single producer ring.
+// Joystick axes get every raw axis event at its device timestamp, virtual
+// joystick axes a sample per update. Nothing is captured while no channel is
+// selected.
+
+constexpr uint32_t state_max_plot_channels = 8;
+constexpr uint32_t state_plot_capacity = 8192;
+
+enum class PlotSource : uint32_t
+{
+    None,
+    JoystickAxis,
+    VirtualJoystickAxis,
+};
+
+struct PlotChannel
+{
+    PlotSource source;
+    uint32_t index;
+
+    // SDL_JoystickID or VirtualJoystickState::id
+    uint64_t device;
+};
+
+struct PlotSelection
+{
+    std::array<PlotChannel, state_max_plot_channels> channels;
+};
+
+struct PlotSample
+{
+    int64_t time_ns;
+    float value;
+
+    // Low bits of the selection sequence this sample was captured for
+    uint32_t generation;
+};
+
+struct PlotRing
+{
+    std::atomic<uint64_t> head;
+    std::array<PlotSample, state_plot_capacity> samples;
+
+    void Push(const PlotSample& sample)
+    {
+        auto index = head.load(std::memory_order_relaxed);
+        samples[index % state_plot_capacity] = sample;
+        head.store(index + 1, std::memory_order_release);
+    }
+};
+
+// -----------------------------------------------------------------------------
+
+struct StateRegion
+{
+    uint32_t magic;
+    uint32_t version;
+    uint64_t size;
+
+    // steady_clock time of the last reader frame, state is only published while readers are attached
+    std::atomic<int64_t> reader_heartbeat_ns;
+
+    // Token of the attached reader, the plot selection and plot ring cursors only support one
+    std::atomic<int64_t> reader_owner;
+
+    // Minimum time between published snapshots, readers never draw faster than this
+    std::atomic<int64_t> reader_interval_ns;
+
+    SeqLocked<EngineState> state;
+    SeqLocked<LockStatsState> lock_stats;
+
+    SeqLocked<PlotSelection> plot_selection;
+    std::array<PlotRing, state_max_plot_channels> plot_rings;
+};
+
+// Reader heartbeats older than this are treated as detached
+constexpr int64_t state_reader_timeout_ns = 1'000'000'000;
+
+inline
+int64_t StateClockNow()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Claims the region for a single reader, returns its owner token or 0 if another reader is attached.
+// The stale heartbeat is swapped for a fresh one so that only one of several racing claims can win.
+inline
+int64_t ClaimStateReader(StateRegion* region)
+{
+    auto now = StateClockNow();
+    auto heartbeat = region->reader_heartbeat_ns.load(std::memory_order_relaxed);
+    if (now - heartbeat <= state_reader_timeout_ns) return 0;
+    if (!region->reader_heartbeat_ns.compare_exchange_strong(heartbeat, now, std::memory_order_acq_rel)) return 0;
+
+    region->reader_owner.store(now, std::memory_order_release);
+
+    // Drop whatever selection a previous reader left behind
+    region->plot_selection.Write([](PlotSelection& selection) { selection = {}; });
+    return now;
+}
+
+inline
+void ReleaseStateReader(StateRegion* region, int64_t token)
+{
+    if (region->reader_owner.compare_exchange_strong(token, 0, std::memory_order_acq_rel)) {
+        region->reader_heartbeat_ns.store(0, std::memory_order_relaxed);
+    }
+}
@@ -0,0 +1,131 @@
+#include "mapper.hpp"
+
+#include <cstdio>
+
+static_assert(max_key_code < telemetry_max_keys);
+static_assert(max_mouse_button_count <= 32);
+
+static
+void SetName(char (&out)[64], const char* name)
+{
+    std::snprintf(out, sizeof(out), "%s", name ? name : "");
+}
+
+static
+void SetKeys(uint64_t (&out)[telemetry_max_keys / 64], const std::bitset<max_key_code + 1>& keys)
+{
+    std::ranges::fill(out, 0);
+    if (keys.none()) return;
+    for (uint32_t code = 0; code <= max_key_code; ++code) {
+        if (keys[code]) out[code / 64] |= 1ull << (code % 64);
+    }
+}
+
+static
+void CaptureTelemetry(TelemetryFrame& out)
+{
+    out.stats = {
+        .timestamp_ns = StateClockNow(),
+        .frame = frame,
+        .average_script_ns = int64_t(average_script_dur.count()),
+        .average_script_util = average_script_util,
+        .script_memory = 0,
+        .bytecode_cache_hits = bytecode_cache_hits,
+        .bytecode_cache_misses = bytecode_cache_misses,
+        .bytecode_cache_saved_ns = int64_t(bytecode_cache_saved.count()),
+    };
+
+    out.num_devices = 0;
+    for (auto* joystick : joysticks) {
+        if (out.num_devices >= telemetry_max_devices) break;
+        auto& device = out.devices[out.num_devices++];
+
+        SetName(device.name, SDL_GetJoystickName(joystick));
+        device.vendor_id = SDL_GetJoystickVendor(joystick);
+        device.product_id = SDL_GetJoystickProduct(joystick);
+        device.num_axes = uint16_t(std::clamp(SDL_GetNumJoystickAxes(joystick), 0, int(telemetry_max_axes)));
+        device.num_buttons = uint16_t(std::clamp(SDL_GetNumJoystickButtons(joystick), 0, int(telemetry_max_buttons)));
+
+        for (int i = 0; i < device.num_axes; ++i) {
+            device.axes[i] = FromSNorm(SDL_GetJoystickAxis(joystick, i));
+        }
+        std::ranges::fill(device.buttons, 0);
+        for (int i = 0; i < device.num_buttons; ++i) {
+            if (SDL_GetJoystickButton(joystick, i)) device.buttons[i / 64] |= 1ull << (i % 64);
+        }
+    }
+
+    out.num_vjoysticks = 0;
+    out.num_input_devices = 0;
+    out.num_vmice = 0;
+    out.num_vkeyboards = 0;
+    for (auto* script : scripts) {
+        out.stats.script_memory += script->arena.live.Get();
+
+        for (auto* input : script->input_devices) {
+            if (out.num_input_devices >= telemetry_max_input_devices) break;
+            auto& device = out.input_devices[out.num_input_devices++];
+
+            SetName(device.name, input->name.c_str());
+            SetKeys(device.keys, input->state.keys);
+            device.rel_x = input->state.rel_x;
+            device.rel_y = input->state.rel_y;
+            device.wheel = input->state.wheel;
+            device.hwheel = input->state.hwheel;
+            device.events_received = input->events_received.load(std::memory_order_relaxed);
+        }
+
+        for (auto* mouse : script->vmice) {
+            if (out.num_vmice >= telemetry_max_vmice) break;
+            auto& device = out.vmice[out.num_vmice++];
+
+            SetName(device.name, mouse->name.c_str());
+            device.vendor_id = mouse->vendor_id;
+            device.product_id = mouse->product_id;
+            device.buttons = 0;
+            for (uint32_t i = 0; i < max_mouse_button_count; ++i) {
+                if (mouse->buttons[i]) device.buttons |= 1u << i;
+            }
+            device.velocity_x = mouse->velocity_x;
+            device.velocity_y = mouse->velocity_y;
+            device.velocity_wheel = mouse->velocity_wheel;
+            device.velocity_hwheel = mouse->velocity_hwheel;
+            device.reports_emitted = mouse->reports_emitted;
+        }
+
+        for (auto* keyboard : script->vkeyboards) {
+            if (out.num_vkeyboards >= telemetry_max_vkeyboards) break;
+            auto& device = out.vkeyboards[out.num_vkeyboards++];
+
+            SetName(device.name, keyboard->name.c_str());
+            device.vendor_id = keyboard->vendor_id;
+            device.product_id = keyboard->product_id;
+            device.reserved = 0;
+            SetKeys(device.keys, keyboard->keys);
+            device.reports_emitted = keyboard->reports_emitted;
+        }
+
+        for (auto* vjoy : script->vjoysticks) {
+            if (out.num_vjoysticks >= telemetry_max_vjoysticks) break;
+            auto& device = out.vjoysticks[out.num_vjoysticks++];
+
+            SetName(device.name, vjoy->name.c_str());
+            device.vendor_id = vjoy->vendor_id;
+            device.product_id = vjoy->product_id;
+            device.num_axes = uint16_t(std::min<uint32_t>(vjoy->num_axes, telemetry_max_axes));
+            device.num_buttons = uint16_t(std::min<uint32_t>(vjoy->num_buttons, telemetry_max_buttons));
+
+            std::copy_n(vjoy->axes.begin(), device.num_axes, device.axes);
+            std::ranges::fill(device.buttons, 0);
+            for (uint32_t i = 0; i < device.num_buttons; ++i) {
+                if (vjoy->buttons[i]) device.buttons[i / 64] |= 1ull << (i % 64);
+            }
+        }
+    }
+}
+
+void WriteTelemetry()
+{
+    if (!telemetry) return;
+    telemetry->frame.Write(CaptureTelemetry);
+}
@@ -0,0 +1,132 @@
+#pragma once
+
+#include "seqlock.hpp"
+
+#include <cstddef>
+#include <cstdint>
+#include <filesystem>
+
+// -----------------------------------------------------------------------------
+//          Telemetry
+// -----------------------------------------------------------------------------
+
+// Public layout of the telemetry file written with --telemetry <path>. External
+// readers map the file read-only and copy `frame` out under the seqlock:
+//
+//   1. s0 = sequence (acquire), retry if odd
+//   2. copy frame
+//   3. acquire fence, retry if sequence != s0
+//
+// All fields are fixed size and little endian. Any layout change bumps the version.
+
+constexpr uint32_t telemetry_magic = 0x4D4C4554; // "TELM"
+constexpr uint32_t telemetry_version = 2;
+
+constexpr uint32_t telemetry_max_devices = 16;
+constexpr uint32_t telemetry_max_vjoysticks = 16;
+constexpr uint32_t telemetry_max_axes = 24;
+constexpr uint32_t telemetry_max_buttons = 128;
+
+constexpr uint32_t telemetry_max_input_devices = 16;
+constexpr uint32_t telemetry_max_vmice = 8;
+constexpr uint32_t telemetry_max_vkeyboards = 8;
+
+// evdev key codes, one bit per code
+constexpr uint32_t telemetry_max_keys = 768;
+
+struct TelemetryDevice
+{
+    char name[64];
+    uint16_t vendor_id;
+    uint16_t product_id;
+    uint16_t num_axes;
+    uint16_t num_buttons;
+    float axes[telemetry_max_axes];
+    uint64_t buttons[telemetry_max_buttons / 64];
+};
+
+// Keyboard or mouse read through evdev
+struct TelemetryInputDevice
+{
+    char name[64];
+    uint64_t keys[telemetry_max_keys / 64];
+
+    // Relative motion received during the last engine frame
+    int32_t rel_x;
+    int32_t rel_y;
+    int32_t wheel;
+    int32_t hwheel;
+
+    uint64_t events_received;
+};
+
+struct TelemetryVirtualMouse
+{
+    char name[64];
+    uint16_t vendor_id;
+    uint16_t product_id;
+    uint32_t buttons;
+
+    // Counts per second
+    float velocity_x;
+    float velocity_y;
+    float velocity_wheel;
+    float velocity_hwheel;
+
+    uint64_t reports_emitted;
+};
+
+struct TelemetryVirtualKeyboard
+{
+    char name[64];
+    uint16_t vendor_id;
+    uint16_t product_id;
+    uint32_t reserved;
+    uint64_t keys[telemetry_max_keys / 64];
+    uint64_t reports_emitted;
+};
+
+struct TelemetryStats
+{
+    // steady_clock time of the last engine update
+    int64_t timestamp_ns;
+    uint64_t frame;
+    int64_t average_script_ns;
+    double average_script_util;
+    uint64_t script_memory;
+    uint64_t bytecode_cache_hits;
+    uint64_t bytecode_cache_misses;
+    int64_t bytecode_cache_saved_ns;
+};
+
+struct TelemetryFrame
+{
+    TelemetryStats stats;
+    uint32_t num_devices;
+    uint32_t num_vjoysticks;
+    TelemetryDevice devices[telemetry_max_devices];
+    TelemetryDevice vjoysticks[telemetry_max_vjoysticks];
+
+    uint32_t num_input_devices;
+    uint32_t num_vmice;
+    uint32_t num_vkeyboards;
+    uint32_t reserved;
+    TelemetryInputDevice input_devices[telemetry_max_input_devices];
+    TelemetryVirtualMouse vmice[telemetry_max_vmice];
+    TelemetryVirtualKeyboard vkeyboards[telemetry_max_vkeyboards];
+};
+
+struct TelemetryRegion
+{
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size;
+    uint32_t reserved;
+    SeqLocked<TelemetryFrame> frame;
+};
+
+static_assert(sizeof(std::atomic<uint64_t>) == sizeof(uint64_t));
+static_assert(offsetof(TelemetryRegion, frame) == 16);
+
+TelemetryRegion* OpenTelemetry(const std::filesystem::path& path);
+void CloseTelemetry(TelemetryRegion* region);
@@ -0,0 +1,239 @@
+#include "mapper.hpp"
+
+#if defined(MAPPER_TRACING)
+
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <unordered_set>
+
+// Each thread records into its own ring, publishing the event count with a
+// release store. Writing a trace only snapshots the published counts under the
+// lock, then copies and encodes on a background thread while threads keep
+// recording. Events overwritten during the copy are discarded.
+
+struct TraceEvent
+{
+    int64_t begin_ns;
+    int64_t end_ns;
+    const char* name;
+    const char* label;
+};
+
+// 8 MiB per thread, tens of seconds of engine activity
+constexpr uint64_t trace_ring_events = 1 << 18;
+
+struct TraceBuffer
+{
+    uint32_t thread_id;
+    std::atomic<const char*> thread_name = nullptr;
+    std::atomic<uint64_t> count = 0;
+
+    // Events before this index were recorded by an earlier tracing session
+    uint64_t first = 0;
+    std::unique_ptr<TraceEvent[]> events{ new TraceEvent[trace_ring_events] };
+
+    void Push(const TraceEvent& event)
+    {
+        auto index = count.load(std::memory_order_relaxed);
+        events[index % trace_ring_events] = event;
+        count.store(index + 1, std::memory_order_release);
+    }
+};
+
+static struct
+{
+    std::mutex mutex;
+    std::filesystem::path path;
+    std::vector<std::unique_ptr<TraceBuffer>> buffers;
+    std::unordered_set<std::string> names;
+    int64_t start_ns = 0;
+
+    std::jthread writer;
+    std::atomic<bool> writing = false;
+} trace;
+
+static thread_local TraceBuffer* trace_buffer = nullptr;
+
+static
+TraceBuffer* GetTraceBuffer()
+{
+    if (trace_buffer) return trace_buffer;
+
+    std::scoped_lock _{ trace.mutex };
+    auto buffer = std::make_unique<TraceBuffer>();
+    buffer->thread_id = uint32_t(trace.buffers.size() + 1);
+    trace_buffer = buffer.get();
+    trace.buffers.emplace_back(std::move(buffer));
+    return trace_buffer;
+}
+
+void RecordTraceSpan(const char* name, const char* label, int64_t begin_ns, int64_t end_ns)
+{
+    GetTraceBuffer()->Push({ begin_ns, end_ns, name, label });
+}
+
+const char* InternTraceName(std::string_view name)
+{
+    std::scoped_lock _{ trace.mutex };
+    return trace.names.emplace(name).first->c_str();
+}
+
+void SetTraceThreadName(const char* name)
+{
+    GetTraceBuffer()->thread_name.store(name, std::memory_order_relaxed);
+}
+
+void StartTracing(const std::filesystem::path& path)
+{
+    {
+        std::scoped_lock _{ trace.mutex };
+        for (auto& buffer : trace.buffers) {
+            buffer->first = buffer->count.load(std::memory_order_relaxed);
+        }
+    }
+
+    trace.path = path;
+    trace.start_ns = TraceClockNow();
+    tracing = true;
+    Log("Tracing to: {}", path.string());
+}
+
+static
+void WriteJsonString(std::ostream& out, std::string_view str)
+{
+    out << '"';
+    for (auto c : str) {
+        if      (c == '"' || c == '\\') out << '\\' << c;
+        else if (uint8_t(c) < 0x20)     out << std::format("\\u{:04x}", uint8_t(c));
+        else                            out << c;
+    }
+    out << '"';
+}
+
+struct TraceSnapshot
+{
+    TraceBuffer* buffer;
+    const char* thread_name;
+    uint64_t first;
+    uint64_t count;
+};
+
+static
+void EncodeTrace(const std::filesystem::path& path, int64_t start_ns, const std::vector<TraceSnapshot>& snapshots)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    if (!out) {
+        LogWarn("Failed to open trace file [{}]", path.string());
+        return;
+    }
+
+    uint64_t total = 0;
+    uint64_t discarded = 0;
+    bool first = true;
+    auto separator = [&] {
+        if (!first) out << ",\n";
+        first = false;
+    };
+
+    out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n";
+
+    std::vector<TraceEvent> events;
+    for (auto& snapshot : snapshots) {
+        auto* buffer = snapshot.buffer;
+        if (snapshot.thread_name) {
+            separator();
+            out << std::format(R"({{"ph":"M","pid":1,"tid":{},"name":"thread_name","args":{{"name":)", buffer->thread_id);
+            WriteJsonString(out, snapshot.thread_name);
+            out << "}}";
+        }
+
+        // Copy the most recent window, then drop anything the thread wrapped over while it was copied
+        auto begin = std::max(snapshot.first, snapshot.count > trace_ring_events ? snapshot.count - trace_ring_events : 0);
+        events.clear();
+        for (auto i = begin; i < snapshot.count; ++i) {
+            events.push_back(buffer->events[i % trace_ring_events]);
+        }
+        // The thread may already be writing event `count`, which reuses the slot of event `count - trace_ring_events`
+        std::atomic_thread_fence(std::memory_order_acquire);
+        auto count = buffer->count.load(std::memory_order_relaxed);
+        auto overwritten = count + 1 > trace_ring_events ? count + 1 - trace_ring_events : 0;
+        auto skip = overwritten > begin ? std::min(overwritten - begin, uint64_t(events.size())) : 0;
+        discarded += begin - snapshot.first + skip;
+
+        for (auto& event : std::span(events).subspan(skip)) {
+            // Complete events, timestamps are in microseconds relative to the start of the trace
+            separator();
+            out << std::format(R"({{"ph":"X","pid":1,"tid":{},"ts":{:.3f},"dur":{:.3f},"name":)",
+                buffer->thread_id, double(event.begin_ns - start_ns) / 1e3, double(event.end_ns - event.begin_ns) / 1e3);
+            WriteJsonString(out, event.name);
+            if (event.label) {
+                out << R"(,"args":{"label":)";
+                WriteJsonString(out, event.label);
+                out << '}';
+            }
+            out << '}';
+            ++total;
+        }
+    }
+
+    out << "\n]}\n";
+
+    Log("Wrote {} trace events to [{}]{}", total, path.string(), discarded ? std::format(", {} older events dropped", discarded) : "");
+}
+
+void WriteTrace()
+{
+    if (!tracing) return;
+
+    if (trace.writing.exchange(true)) {
+        LogWarn("Trace write already in progress");
+        return;
+    }
+
+    std::vector<TraceSnapshot> snapshots;
+    {
+        std::scoped_lock _{ trace.mutex };
+        for (auto& buffer : trace.buffers) {
+            snapshots.push_back({
+                .buffer      = buffer.get(),
+                .thread_name = buffer->thread_name.load(std::memory_order_relaxed),
+                .first       = buffer->first,
+                .count       = buffer->count.load(std::memory_order_acquire),
+            });
+        }
+    }
+
+    // Buffers are never freed, so the writer can read them without the lock
+    trace.writer = std::jthread([path = trace.path, start_ns = trace.start_ns, snapshots = std::move(snapshots)] {
+        MAPPER_TRACE_THREAD("Trace Writer");
+        EncodeTrace(path, start_ns, snapshots);
+        trace.writing = false;
+    });
+}
+
+void StopTracing()
+{
+    if (trace.writer.joinable()) trace.writer.join();
+    WriteTrace();
+    if (trace.writer.joinable()) trace.writer.join();
+    tracing = false;
+}
+
+#else
+
+void StartTracing(const std::filesystem::path&)
+{
+    Error("Tracing is not available, rebuild with MAPPER_TRACING enabled");
+}
+
+void WriteTrace()
+{
+}
+
+void StopTracing()
+{
+}
+
+#endif
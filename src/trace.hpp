@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+
+#if defined(MAPPER_TRACING)
+#include <atomic>
+#include <chrono>
+#endif
+
+// -----------------------------------------------------------------------------
+//          Tracing
+// -----------------------------------------------------------------------------
+
+// With MAPPER_TRACING defined, spans are recorded as fixed size binary events
+// into a buffer owned by the recording thread, and are only encoded when the
+// trace is written out as Chrome JSON (viewable in Perfetto or chrome://tracing).
+// Each thread keeps the most recent trace_ring_events spans. Recording starts
+// with --trace <path>, the file is rewritten in the background on the "trace"
+// command and on exit. Without MAPPER_TRACING, spans compile to nothing.
+
+void StartTracing(const std::filesystem::path& path);
+void WriteTrace();
+void StopTracing();
+
+#if defined(MAPPER_TRACING)
+
+inline std::atomic<bool> tracing = false;
+
+inline
+int64_t TraceClockNow()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Names must outlive the trace, use string literals or InternTraceName
+void RecordTraceSpan(const char* name, const char* label, int64_t begin_ns, int64_t end_ns);
+const char* InternTraceName(std::string_view name);
+void SetTraceThreadName(const char* name);
+
+struct TraceSpan
+{
+    const char* name;
+    const char* label;
+    int64_t begin_ns;
+
+    TraceSpan(const char* _name, const char* _label = nullptr)
+        : name(_name)
+        , label(_label)
+        , begin_ns(tracing.load(std::memory_order_relaxed) ? TraceClockNow() : 0)
+    {}
+
+    ~TraceSpan()
+    {
+        if (begin_ns) RecordTraceSpan(name, label, begin_ns, TraceClockNow());
+    }
+};
+
+#define MAPPER_TRACE_CONCAT_(a, b) a##b
+#define MAPPER_TRACE_CONCAT(a, b) MAPPER_TRACE_CONCAT_(a, b)
+#define MAPPER_TRACE_SPAN(...) TraceSpan MAPPER_TRACE_CONCAT(trace_span_, __LINE__){ __VA_ARGS__ }
+#define MAPPER_TRACE_THREAD(name) SetTraceThreadName(name)
+
+#else
+
+#define MAPPER_TRACE_SPAN(...)
+#define MAPPER_TRACE_THREAD(name)
+
+#endif
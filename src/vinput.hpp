@@ -0,0 +1,214 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+
+#include <array>
+#include <bitset>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <optional>
+#include <algorithm>
+
+// Key codes follow the Linux evdev KEY_* numbering, which matches scancode set 1
+// for the main block of the keyboard
+constexpr uint32_t max_key_code = 0x2ff;
+constexpr uint32_t max_mouse_button_count = 5;
+
+// BTN_LEFT, followed by BTN_RIGHT, BTN_MIDDLE, BTN_SIDE and BTN_EXTRA
+constexpr uint16_t mouse_button_base_code = 0x110;
+
+// Codes a virtual keyboard advertises, every key up to max_key_code except the BTN_MISC
+// to BTN_GEAR_UP and BTN_TRIGGER_HAPPY button ranges, which would get the device
+// classified as a mouse, joystick or tablet
+constexpr bool IsKeyboardKeyCode(uint32_t code)
+{
+    return (code >= 0x01 && code < 0x100)
+        || (code >= 0x160 && code < 0x2c0)
+        || (code >= 0x2e8 && code <= max_key_code);
+}
+
+std::optional<uint16_t> KeyCodeFromName(std::string_view name);
+
+// -----------------------------------------------------------------------------
+//          Virtual Mouse
+// -----------------------------------------------------------------------------
+
+struct VirtualMouseDesc
+{
+    std::string name = {};
+
+    // Only used for evdev backend
+    uint16_t version = 0;
+    uint16_t vendor_id = 0;
+    uint16_t product_id = 0;
+
+    // Rate at which velocities are integrated into relative motion reports
+    float tick_rate = 1000.f;
+};
+
+struct VirtualMouse : VirtualMouseDesc
+{
+    // Velocities in counts per second, accumulated with sub-count precision
+    float velocity_x = 0.f;
+    float velocity_y = 0.f;
+    float velocity_wheel = 0.f;
+    float velocity_hwheel = 0.f;
+
+    std::array<double, 4> remainder = {};
+
+    // Whole counts pending for the next report
+    int32_t delta_x = 0;
+    int32_t delta_y = 0;
+    int32_t delta_wheel = 0;
+    int32_t delta_hwheel = 0;
+
+    std::array<bool, max_mouse_button_count> buttons = {};
+
+    bool dirty = false;
+
+    std::chrono::steady_clock::time_point last_tick = {};
+    std::chrono::steady_clock::time_point next_tick = {};
+    uint64_t reports_emitted = 0;
+
+#if defined(MAPPER_TRACING)
+    // Interned name labelling this device's output trace spans
+    const char* trace_label = nullptr;
+#endif
+
+    void Destroy();
+
+    // Ticks only run while the engine presents frames, so motion starting from rest integrates from now
+    void StartMotion()
+    {
+        if (Moving()) return;
+        last_tick = next_tick = std::chrono::steady_clock::now();
+    }
+
+    void SetVelocity(float x, float y)
+    {
+        if (x || y) StartMotion();
+        velocity_x = x;
+        velocity_y = y;
+    }
+
+    void SetWheelVelocity(float wheel, float hwheel)
+    {
+        if (wheel || hwheel) StartMotion();
+        velocity_wheel = wheel;
+        velocity_hwheel = hwheel;
+    }
+
+    void Move(int32_t x, int32_t y)
+    {
+        delta_x += x;
+        delta_y += y;
+        dirty = true;
+    }
+
+    void SetButton(uint32_t index, bool state)
+    {
+        if (index >= max_mouse_button_count || buttons[index] == state) return;
+        buttons[index] = state;
+        dirty = true;
+    }
+
+    bool Moving()
+    {
+        return velocity_x || velocity_y || velocity_wheel || velocity_hwheel;
+    }
+
+    bool Update();
+
+    // Integrates velocities up to `now` and reports, returns true if further ticks are required
+    bool Present(std::chrono::steady_clock::time_point now)
+    {
+        auto period = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+            std::chrono::duration<double>(1.0 / std::max(tick_rate, 1.f)));
+
+        if (!Moving()) {
+            last_tick = now;
+            remainder = {};
+        } else if (now >= next_tick) {
+            // Clamp to avoid a jump if the engine thread stalls mid-motion
+            double dt = std::min(std::chrono::duration<double>(now - last_tick).count(), 0.05);
+            last_tick = now;
+
+            auto integrate = [&](uint32_t i, float velocity, int32_t& delta) {
+                remainder[i] += velocity * dt;
+                auto whole = std::trunc(remainder[i]);
+                remainder[i] -= whole;
+                if (whole) {
+                    delta += int32_t(whole);
+                    dirty = true;
+                }
+            };
+
+            integrate(0, velocity_x, delta_x);
+            integrate(1, velocity_y, delta_y);
+            integrate(2, velocity_wheel, delta_wheel);
+            integrate(3, velocity_hwheel, delta_hwheel);
+
+            next_tick = now + period;
+        }
+
+        if (dirty && Update()) {
+            ++reports_emitted;
+        }
+
+        return Moving();
+    }
+};
+
+VirtualMouse* CreateVirtualMouse(const VirtualMouseDesc& desc);
+
+// -----------------------------------------------------------------------------
+//          Virtual Keyboard
+// -----------------------------------------------------------------------------
+
+struct VirtualKeyboardDesc
+{
+    std::string name = {};
+
+    // Only used for evdev backend
+    uint16_t version = 0;
+    uint16_t vendor_id = 0;
+    uint16_t product_id = 0;
+};
+
+struct VirtualKeyboard : VirtualKeyboardDesc
+{
+    std::bitset<max_key_code + 1> keys;
+    std::bitset<max_key_code + 1> last_keys;
+
+    bool dirty = false;
+    uint64_t reports_emitted = 0;
+
+#if defined(MAPPER_TRACING)
+    // Interned name labelling this device's output trace spans
+    const char* trace_label = nullptr;
+#endif
+
+    void Destroy();
+
+    bool GetKey(uint16_t code) { return code <= max_key_code && keys[code]; }
+
+    void SetKey(uint16_t code, bool state)
+    {
+        if (code > max_key_code || keys[code] == state) return;
+        keys[code] = state;
+        dirty = true;
+    }
+
+    bool Update();
+
+    void Present()
+    {
+        if (dirty && Update()) {
+            ++reports_emitted;
+        }
+    }
+};
+
+VirtualKeyboard* CreateVirtualKeyboard(const VirtualKeyboardDesc& desc);
@@ -3,6 +3,10 @@
 #include <array>
 #include <cstdint>
 #include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <optional>
 
 constexpr uint32_t max_axis_count = 19;
 constexpr uint32_t max_button_count = 128;
@@ -21,22 +25,132 @@ struct VirtualJoystickDesc
 
     uint16_t num_axes = 0;
     uint16_t num_buttons = 0;
+
+    // Maximum reports per second, 0 = report on every update.
+    // Changes between reports are coalesced, latest value wins.
+    float max_report_rate = 0.f;
+
+    // Report button edges immediately regardless of pacing
+    bool flush_on_button = true;
+
+    // Accept force feedback effects from applications
+    bool force_feedback = false;
+
+    bool operator==(const VirtualJoystickDesc&) const = default;
+};
+
+struct ForceFeedbackRoute
+{
+    // SDL_JoystickID of the physical joystick to rumble, 0 = consume without output
+    uint32_t target = 0;
+
+    float scale = 1.f;
+    bool swap_motors = false;
+    bool drop = false;
+};
+
+struct ForceFeedbackStats
+{
+    std::atomic<uint64_t> uploads = 0;
+    std::atomic<uint64_t> plays = 0;
+    std::atomic<uint64_t> dropped = 0;
+
+    // Moving average from the application submitting an effect to the rumble being issued
+    std::atomic<int64_t> average_round_trip_ns = 0;
 };
 
 struct VirtualJoystick : VirtualJoystickDesc
 {
+    // Addresses commands and plot channels, never reused. Kept while a device is reused across a reload.
+    uint64_t id = 0;
+
     std::array<float, max_axis_count> axes;
     std::array<bool, max_button_count> buttons;
 
+    // Set whenever an output is written, cleared by Update
+    bool dirty = false;
+    bool button_edge = false;
+
+    std::chrono::steady_clock::time_point next_report = {};
+    uint64_t reports_emitted = 0;
+
+    // Reports held back by pacing that absorbed outputs written after they were held back
+    uint64_t reports_coalesced = 0;
+    bool report_deferred = false;
+    bool report_absorbed = false;
+
+#if defined(MAPPER_TRACING)
+    // Interned name labelling this device's output trace spans
+    const char* trace_label = nullptr;
+#endif
+
+    // Force feedback is serviced on its own thread, route changes are guarded by ff_mutex
+    std::mutex ff_mutex;
+    ForceFeedbackRoute ff_route;
+    ForceFeedbackStats ff_stats;
+
     void Destroy();
 
     float  GetAxis(uint32_t index) { return    axes[index]; }
     bool GetButton(uint32_t index) { return buttons[index]; }
 
-    void   SetAxis(uint32_t index, float value) {    axes[index] = std::clamp(value, -1.f, 1.f); }
-    void SetButton(uint32_t index, bool  state) { buttons[index] = state;                        }
+    void SetAxis(uint32_t index, float value)
+    {
+        axes[index] = std::clamp(value, -1.f, 1.f);
+        dirty = true;
+        report_absorbed |= report_deferred;
+    }
+
+    void SetButton(uint32_t index, bool state)
+    {
+        if (buttons[index] != state) button_edge = true;
+        buttons[index] = state;
+        dirty = true;
+        report_absorbed |= report_deferred;
+    }
 
     bool Update();
+
+    // Applies output pacing before updating, returns true if a report is still pending
+    bool Present(std::chrono::steady_clock::time_point now)
+    {
+        if (!dirty) return false;
+
+        bool paced = max_report_rate > 0.f;
+        if (paced && now < next_report && !(flush_on_button && button_edge)) {
+            report_deferred = true;
+            return true;
+        }
+
+        if (report_absorbed) ++reports_coalesced;
+        report_deferred = false;
+        report_absorbed = false;
+        button_edge = false;
+        if (Update()) {
+            ++reports_emitted;
+            if (paced) {
+                next_report = now + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                    std::chrono::duration<double>(1.0 / max_report_rate));
+            }
+        }
+
+        return false;
+    }
 };
 
 VirtualJoystick* CreateVirtualJoystick(const VirtualJoystickDesc& desc);
+
+// Destroyed devices are kept alive for this long, and handed back to a script that
+// creates a device with an identical description. Reloading a script, including
+// fixing one whose reload failed, then leaves its devices in place instead of
+// making them disappear and reappear.
+constexpr auto vjoystick_pool_grace = std::chrono::seconds(30);
+
+// Destroys pooled devices idle past the grace period, returns when the next one expires
+std::optional<std::chrono::steady_clock::time_point> TrimVirtualJoystickPool(std::chrono::steady_clock::time_point now);
+
+// Destroys a released device immediately if it is still pooled, for explicit unloads
+void DestroyPooledVirtualJoystick(VirtualJoystick* vjoy);
+
+void SetForceFeedbackRoute(VirtualJoystick* vjoy, const ForceFeedbackRoute& route);
+void DispatchForceFeedback(VirtualJoystick* vjoy, float low, float high, uint32_t duration_ms, std::chrono::steady_clock::time_point issued);
@@ -0,0 +1,12 @@
+#include <mapper.hpp>
+
+// External input producers connect over Unix domain sockets, which are not yet supported here
+
+void StartExternalInputServer()
+{
+    Error("External inputs are not supported on Windows");
+}
+
+void StopExternalInputServer()
+{
+}
@@ -0,0 +1,12 @@
+#include <mapper.hpp>
+
+InputDevice* OpenInputDevice(const InputDeviceDesc& desc)
+{
+    Error("Input device capture is not supported on Windows: {}", desc.path);
+    return nullptr;
+}
+
+void InputDevice::Destroy()
+{
+    delete this;
+}
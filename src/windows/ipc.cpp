@@ -0,0 +1,53 @@
+#include <mapper.hpp>
+
+// Daemon mode is not yet supported on Windows, only the in-process GUI uses a state region
+
+StateRegion* CreateStateRegion(bool shared)
+{
+    if (shared) {
+        Error("Shared state regions are not supported on Windows");
+    }
+
+    auto region = new StateRegion{};
+    region->magic = state_region_magic;
+    region->version = state_region_version;
+    region->size = sizeof(StateRegion);
+    return region;
+}
+
+void DestroyStateRegion(StateRegion* region, bool)
+{
+    delete region;
+}
+
+StateRegion* OpenStateRegion()
+{
+    Error("Attaching to a daemon is not supported on Windows");
+    return nullptr;
+}
+
+void StartCommandServer()
+{
+    Error("The command server is not supported on Windows");
+}
+
+void StopCommandServer()
+{
+}
+
+struct CommandConnection {};
+
+CommandConnection* ConnectCommandServer()
+{
+    Error("The command server is not supported on Windows");
+    return nullptr;
+}
+
+void SendCommand(CommandConnection*, const Command&)
+{
+}
+
+void CloseCommandConnection(CommandConnection* connection)
+{
+    delete connection;
+}
@@ -0,0 +1,35 @@
+#include <mapper.hpp>
+
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+PersistentFile* MapPersistentFile(const std::filesystem::path& path)
+{
+    auto file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ,
+        nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        Error("Failed to open persistent state [{}]: {}", path.string(), GetLastError());
+    }
+    Defer close_file = [&] { CloseHandle(file); };
+
+    auto mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE, 0, DWORD(sizeof(PersistentFile)), nullptr);
+    if (!mapping) {
+        Error("Failed to create persistent state mapping [{}]: {}", path.string(), GetLastError());
+    }
+    Defer close_mapping = [&] { CloseHandle(mapping); };
+
+    auto memory = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, sizeof(PersistentFile));
+    if (!memory) {
+        Error("Failed to map persistent state [{}]: {}", path.string(), GetLastError());
+    }
+
+    return static_cast<PersistentFile*>(memory);
+}
+
+void UnmapPersistentFile(PersistentFile* file)
+{
+    // Queue writeback without waiting on it, dirty pages survive a crash of this process regardless
+    FlushViewOfFile(file, 0);
+    UnmapViewOfFile(file);
+}
@@ -0,0 +1,40 @@
+#include <mapper.hpp>
+
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+TelemetryRegion* OpenTelemetry(const std::filesystem::path& path)
+{
+    auto file = CreateFileW(path.c_str(), GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ | FILE_SHARE_WRITE,
+        nullptr, OPEN_ALWAYS, FILE_ATTRIBUTE_TEMPORARY, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        Error("Failed to open telemetry file [{}]: {}", path.string(), GetLastError());
+    }
+    Defer close_file = [&] { CloseHandle(file); };
+
+    auto mapping = CreateFileMappingW(file, nullptr, PAGE_READWRITE, 0, DWORD(sizeof(TelemetryRegion)), nullptr);
+    if (!mapping) {
+        Error("Failed to create telemetry mapping [{}]: {}", path.string(), GetLastError());
+    }
+    Defer close_mapping = [&] { CloseHandle(mapping); };
+
+    auto memory = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, sizeof(TelemetryRegion));
+    if (!memory) {
+        Error("Failed to map telemetry file [{}]: {}", path.string(), GetLastError());
+    }
+
+    auto region = new (memory) TelemetryRegion{};
+    region->magic = telemetry_magic;
+    region->version = telemetry_version;
+    region->size = sizeof(TelemetryRegion);
+
+    Log("Writing telemetry to: {}", path.string());
+
+    return region;
+}
+
+void CloseTelemetry(TelemetryRegion* region)
+{
+    UnmapViewOfFile(region);
+}
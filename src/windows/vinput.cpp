@@ -0,0 +1,169 @@
+#include <vinput.hpp>
+
+#include <common.hpp>
+
+#include <vector>
+
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <Windows.h>
+
+// SendInput targets the system input queue directly, all inputs for a frame
+// are submitted in a single call.
+
+static
+void SubmitInputs(std::vector<INPUT>& inputs)
+{
+    if (inputs.empty() || null_output) return;
+    auto sent = ::SendInput(UINT(inputs.size()), inputs.data(), sizeof(INPUT));
+    if (sent != inputs.size()) {
+        LogWarn("SendInput submitted {} of {} inputs", sent, inputs.size());
+    }
+}
+
+// -----------------------------------------------------------------------------
+//          Virtual Mouse
+// -----------------------------------------------------------------------------
+
+struct VirtualMouse_SendInput : VirtualMouse
+{
+    std::array<bool, max_mouse_button_count> last_buttons;
+    std::vector<INPUT> inputs;
+};
+
+VirtualMouse* CreateVirtualMouse(const VirtualMouseDesc& desc)
+{
+    return new VirtualMouse_SendInput{{desc}};
+}
+
+void VirtualMouse::Destroy()
+{
+    delete static_cast<VirtualMouse_SendInput*>(this);
+}
+
+bool VirtualMouse::Update()
+{
+    auto self = static_cast<VirtualMouse_SendInput*>(this);
+
+    self->dirty = false;
+
+    auto& inputs = self->inputs;
+    inputs.clear();
+
+    auto push = [&](DWORD flags, LONG dx = 0, LONG dy = 0, DWORD data = 0) {
+        auto& input = inputs.emplace_back();
+        input = {};
+        input.type = INPUT_MOUSE;
+        input.mi.dx = dx;
+        input.mi.dy = dy;
+        input.mi.mouseData = data;
+        input.mi.dwFlags = flags;
+    };
+
+    if (self->delta_x || self->delta_y) push(MOUSEEVENTF_MOVE, self->delta_x, self->delta_y);
+    if (self->delta_wheel)  push(MOUSEEVENTF_WHEEL,  0, 0, DWORD(self->delta_wheel  * WHEEL_DELTA));
+    if (self->delta_hwheel) push(MOUSEEVENTF_HWHEEL, 0, 0, DWORD(self->delta_hwheel * WHEEL_DELTA));
+    self->delta_x = self->delta_y = self->delta_wheel = self->delta_hwheel = 0;
+
+    constexpr std::array<std::pair<DWORD, DWORD>, max_mouse_button_count> button_flags {{
+        { MOUSEEVENTF_LEFTDOWN,   MOUSEEVENTF_LEFTUP   },
+        { MOUSEEVENTF_RIGHTDOWN,  MOUSEEVENTF_RIGHTUP  },
+        { MOUSEEVENTF_MIDDLEDOWN, MOUSEEVENTF_MIDDLEUP },
+        { MOUSEEVENTF_XDOWN,      MOUSEEVENTF_XUP      },
+        { MOUSEEVENTF_XDOWN,      MOUSEEVENTF_XUP      },
+    }};
+
+    for (uint32_t i = 0; i < max_mouse_button_count; ++i) {
+        if (self->buttons[i] == self->last_buttons[i]) continue;
+        self->last_buttons[i] = self->buttons[i];
+        auto flags = self->buttons[i] ? button_flags[i].first : button_flags[i].second;
+        push(flags, 0, 0, i == 3 ? XBUTTON1 : i == 4 ? XBUTTON2 : 0);
+    }
+
+    SubmitInputs(inputs);
+
+    return !inputs.empty();
+}
+
+// -----------------------------------------------------------------------------
+//          Virtual Keyboard
+// -----------------------------------------------------------------------------
+
+struct VirtualKeyboard_SendInput : VirtualKeyboard
+{
+    std::vector<INPUT> inputs;
+};
+
+// evdev codes for keys outside the main block that need an E0 prefixed scancode
+static
+std::optional<WORD> ExtendedScancode(uint16_t code)
+{
+    switch (code) {
+        case  96: return 0x1C; // KPENTER
+        case  97: return 0x1D; // RIGHTCTRL
+        case  98: return 0x35; // KPSLASH
+        case  99: return 0x37; // SYSRQ
+        case 100: return 0x38; // RIGHTALT
+        case 102: return 0x47; // HOME
+        case 103: return 0x48; // UP
+        case 104: return 0x49; // PAGEUP
+        case 105: return 0x4B; // LEFT
+        case 106: return 0x4D; // RIGHT
+        case 107: return 0x4F; // END
+        case 108: return 0x50; // DOWN
+        case 109: return 0x51; // PAGEDOWN
+        case 110: return 0x52; // INSERT
+        case 111: return 0x53; // DELETE
+        case 125: return 0x5B; // LEFTMETA
+        case 126: return 0x5C; // RIGHTMETA
+    }
+    return std::nullopt;
+}
+
+VirtualKeyboard* CreateVirtualKeyboard(const VirtualKeyboardDesc& desc)
+{
+    return new VirtualKeyboard_SendInput{{desc}};
+}
+
+void VirtualKeyboard::Destroy()
+{
+    delete static_cast<VirtualKeyboard_SendInput*>(this);
+}
+
+bool VirtualKeyboard::Update()
+{
+    auto self = static_cast<VirtualKeyboard_SendInput*>(this);
+
+    self->dirty = false;
+
+    auto changed = self->keys ^ self->last_keys;
+    if (changed.none()) return false;
+    self->last_keys = self->keys;
+
+    auto& inputs = self->inputs;
+    inputs.clear();
+
+    for (uint16_t code = 0; code <= max_key_code; ++code) {
+        if (!changed[code]) continue;
+
+        DWORD flags = KEYEVENTF_SCANCODE;
+        WORD scancode = code;
+        if (auto extended = ExtendedScancode(code)) {
+            scancode = *extended;
+            flags |= KEYEVENTF_EXTENDEDKEY;
+        } else if (code > 0x58) {
+            continue;
+        }
+        if (!self->keys[code]) flags |= KEYEVENTF_KEYUP;
+
+        auto& input = inputs.emplace_back();
+        input = {};
+        input.type = INPUT_KEYBOARD;
+        input.ki.wScan = scancode;
+        input.ki.dwFlags = flags;
+    }
+
+    SubmitInputs(inputs);
+
+    return true;
+}
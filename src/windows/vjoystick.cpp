@@ -13,10 +13,19 @@ struct VirtualJoystick_VJoy : VirtualJoystick
 {
     std::array<float, max_axis_count> last_axes;
     std::array<bool, max_button_count> last_buttons;
+
+    // Not backed by a vJoy device, see null_output
+    bool null = false;
 };
 
 VirtualJoystick* CreateVirtualJoystick(const VirtualJoystickDesc& desc)
 {
+    if (null_output) {
+        auto joy = new VirtualJoystick_VJoy{{desc}};
+        joy->null = true;
+        return joy;
+    }
+
     if (!vjoy::Load()) {
         Error("[vJoy] Failed to load vJoy functions");
     }
@@ -40,14 +49,30 @@ VirtualJoystick* CreateVirtualJoystick(const VirtualJoystickDesc& desc)
         Error("[vJoy] Device does not have enough buttons. Expected {} got {}", desc.num_buttons, avail_buttons);
     }
 
+    if (desc.force_feedback) {
+        LogWarn("[vJoy] Force feedback routing is not supported by the vJoy backend");
+    }
+
     return joy;
 }
 
+std::optional<std::chrono::steady_clock::time_point> TrimVirtualJoystickPool(std::chrono::steady_clock::time_point)
+{
+    // vJoy devices are configured in the driver and outlive the process, acquiring one is already cheap
+    return std::nullopt;
+}
+
+void DestroyPooledVirtualJoystick(VirtualJoystick*)
+{
+}
+
 void VirtualJoystick::Destroy()
 {
     auto self = static_cast<VirtualJoystick_VJoy*>(this);
 
-    vjoy::api::RelinquishVJD(self->device_id);
+    if (!self->null) {
+        vjoy::api::RelinquishVJD(self->device_id);
+    }
 
     delete self;
 }
@@ -56,6 +81,9 @@ bool VirtualJoystick::Update()
 {
     auto self = static_cast<VirtualJoystick_VJoy*>(this);
 
+    if (!self->dirty) return false;
+    self->dirty = false;
+
     vjoy::api::JOYSTICK_POSITION p = {};
     p.bDevice = self->device_id;
 
@@ -100,7 +128,7 @@ bool VirtualJoystick::Update()
         dword = (dword & ~mask) | (self->buttons[i] ? mask : 0);
     }
 
-    if (any_changed) {
+    if (any_changed && !self->null) {
         if (!vjoy::api::UpdateVJD(p.bDevice, &p)) {
             Error("Failed to feed vJoy device: {}", p.bDevice);
         }
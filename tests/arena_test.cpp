@@ -0,0 +1,113 @@
+#include "test.hpp"
+
+#include <cstring>
+
+// -----------------------------------------------------------------------------
+
+static
+void TestSmallAllocations()
+{
+    ScriptArena arena;
+
+    auto a = arena.Allocate(24);
+    auto b = arena.Allocate(24);
+    CHECK(a && b && a != b);
+    CHECK(arena.live.Get() == 48);
+    CHECK(arena.reserved.Get() == ScriptArena::chunk_size);
+
+    // Freed blocks are reused by the same size class
+    arena.Free(a, 24);
+    CHECK(arena.live.Get() == 24);
+    CHECK(arena.Allocate(20) == a);
+    CHECK(arena.peak.Get() == 48);
+}
+
+static
+void TestLargeAllocations()
+{
+    ScriptArena arena;
+
+    auto size = ScriptArena::max_small_size + 1;
+    auto block = arena.Allocate(size);
+    CHECK(block);
+    CHECK(arena.live.Get() == size);
+    CHECK(arena.reserved.Get() > size);
+
+    arena.Free(block, size);
+    CHECK(arena.live.Get() == 0);
+    CHECK(arena.reserved.Get() == 0);
+}
+
+static
+void TestLimit()
+{
+    ScriptArena arena;
+    arena.limit.Set(1024);
+
+    auto block = arena.Allocate(1000);
+    CHECK(block);
+    CHECK(!arena.Allocate(64));
+    CHECK(arena.failed_allocations.Get() == 1);
+
+    // Growing past the limit fails and leaves the block untouched
+    CHECK(!arena.Reallocate(block, 1000, 2000));
+    CHECK(arena.failed_allocations.Get() == 2);
+    CHECK(arena.live.Get() == 1000);
+
+    // Lua requires that shrinking never fails, even over the limit
+    arena.limit.Set(16);
+    auto shrunk = arena.Reallocate(block, 1000, 100);
+    CHECK(shrunk);
+    CHECK(arena.live.Get() == 100);
+    CHECK(arena.limit.Get() == 16);
+}
+
+static
+void TestReallocateInPlace()
+{
+    ScriptArena arena;
+
+    auto block = static_cast<char*>(arena.Allocate(20));
+    std::memcpy(block, "mapper", 7);
+
+    // Same size class, no copy
+    CHECK(arena.Reallocate(block, 20, 30) == block);
+    CHECK(arena.live.Get() == 30);
+
+    // Different size class, contents move with the block
+    auto moved = static_cast<char*>(arena.Reallocate(block, 30, 200));
+    CHECK(moved != block);
+    CHECK(std::memcmp(moved, "mapper", 7) == 0);
+    CHECK(arena.live.Get() == 200);
+}
+
+static
+void TestRelease()
+{
+    ScriptArena arena;
+    arena.Allocate(64);
+    arena.Allocate(4096);
+
+    arena.Release();
+    CHECK(arena.live.Get() == 0);
+    CHECK(arena.reserved.Get() == 0);
+    CHECK(arena.chunks.empty());
+    CHECK(!arena.large_blocks);
+
+    // Frees are ignored while releasing, the memory is returned in bulk
+    auto block = arena.Allocate(64);
+    arena.releasing = true;
+    arena.Free(block, 64);
+    CHECK(arena.live.Get() == 64);
+}
+
+int main()
+{
+    return RunTests({
+        { "arena small allocations",   TestSmallAllocations },
+        { "arena large allocations",   TestLargeAllocations },
+        { "arena limit",               TestLimit },
+        { "arena reallocate in place", TestReallocateInPlace },
+        { "arena release",             TestRelease },
+    });
+}
@@ -0,0 +1,97 @@
+#include "test.hpp"
+
+// -----------------------------------------------------------------------------
+
+static
+void TestParseScriptCommands()
+{
+    auto load = ParseCommand("load /home/user/scripts/flight.lua\n");
+    CHECK(load && load->type == CommandType::LoadScript);
+    CHECK(load && load->path == "/home/user/scripts/flight.lua");
+
+    // Paths may contain spaces, everything after the verb is the path
+    auto reload = ParseCommand("reload /tmp/my scripts/a.lua\r\n");
+    CHECK(reload && reload->type == CommandType::ReloadScript);
+    CHECK(reload && reload->path == "/tmp/my scripts/a.lua");
+
+    auto unload = ParseCommand("unload a.lua");
+    CHECK(unload && unload->type == CommandType::UnloadScript);
+
+    CHECK(!ParseCommand("load"));
+    CHECK(!ParseCommand("load \n"));
+}
+
+static
+void TestParseVirtualJoystickCommands()
+{
+    auto axis = ParseCommand("set-axis 7 2 -0.5\n");
+    CHECK(axis && axis->type == CommandType::SetAxis);
+    CHECK(axis && axis->target == 7 && axis->index == 2 && axis->value == -0.5f);
+
+    auto button = ParseCommand("set-button 3 11 1");
+    CHECK(button && button->type == CommandType::SetButton);
+    CHECK(button && button->target == 3 && button->index == 11 && button->value == 1.f);
+
+    auto reset = ParseCommand("reset 42");
+    CHECK(reset && reset->type == CommandType::ResetVirtualJoystick && reset->target == 42);
+
+    CHECK(!ParseCommand("set-axis 7 2"));
+    CHECK(!ParseCommand("set-axis x 2 0.5"));
+    CHECK(!ParseCommand("set-button 3"));
+    CHECK(!ParseCommand("reset"));
+}
+
+static
+void TestParseOther()
+{
+    auto refresh = ParseCommand("refresh\n");
+    CHECK(refresh && refresh->type == CommandType::Refresh);
+
+    auto trace = ParseCommand("trace");
+    CHECK(trace && trace->type == CommandType::WriteTrace);
+
+    CHECK(!ParseCommand(""));
+    CHECK(!ParseCommand("\n"));
+    CHECK(!ParseCommand("explode now"));
+    CHECK(!ParseCommand("LOAD a.lua"));
+}
+
+static
+void TestRoundTrip()
+{
+    Command commands[] {
+        { .type = CommandType::LoadScript, .path = "/tmp/a b.lua" },
+        { .type = CommandType::ReloadScript, .path = "c.lua" },
+        { .type = CommandType::UnloadScript, .path = "d.lua" },
+        { .type = CommandType::SetAxis, .target = 1ull << 40, .index = 5, .value = 0.25f },
+        { .type = CommandType::SetButton, .target = 2, .index = 127, .value = 0.f },
+        { .type = CommandType::ResetVirtualJoystick, .target = 9 },
+        { .type = CommandType::Refresh },
+        { .type = CommandType::WriteTrace },
+    };
+
+    for (auto& command : commands) {
+        auto line = FormatCommand(command);
+        CHECK(line.ends_with('\n'));
+        CHECK(std::ranges::count(line, '\n') == 1);
+
+        auto parsed = ParseCommand(line);
+        CHECK(parsed);
+        if (!parsed) continue;
+        CHECK(parsed->type == command.type);
+        CHECK(parsed->path == command.path);
+        CHECK(parsed->target == command.target);
+        CHECK(parsed->index == command.index);
+        CHECK(parsed->value == command.value);
+    }
+}
+
+int main()
+{
+    return RunTests({
+        { "parse script commands",           TestParseScriptCommands },
+        { "parse virtual joystick commands", TestParseVirtualJoystickCommands },
+        { "parse other commands",            TestParseOther },
+        { "format round trip",               TestRoundTrip },
+    });
+}
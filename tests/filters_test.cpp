@@ -0,0 +1,89 @@
+#include "test.hpp"
+
+// -----------------------------------------------------------------------------
+
+constexpr uint64_t ms = 1'000'000;
+
+static
+void TestMedian()
+{
+    AxisFilter filter{ .type = FilterType::Median };
+
+    filter.Push(0.f, 0);
+    filter.Push(0.f, 1 * ms);
+    filter.Push(1.f, 2 * ms);
+    CHECK(filter.value == 0.f);
+    filter.Push(1.f, 3 * ms);
+    CHECK(filter.value == 1.f);
+
+    // Median filters only change on new samples
+    CHECK(!filter.Advance(100 * ms));
+}
+
+static
+void TestEMA()
+{
+    AxisFilter filter{ .type = FilterType::EMA, .time_constant = 0.05f };
+
+    filter.Push(0.f, 0);
+    CHECK(filter.value == 0.f);
+    filter.Push(1.f, 50 * ms);
+    CHECK(std::abs(filter.value - (1.f - std::exp(-1.f))) < 1e-4f);
+
+    // Samples stamped before the last step only move the target
+    auto value = filter.value;
+    filter.Push(1.f, 40 * ms);
+    CHECK(filter.value == value);
+
+    uint64_t now = 50 * ms;
+    while (filter.Advance(now += ms) && now < 10'000 * ms) {}
+    CHECK(filter.value == 1.f);
+}
+
+static
+void TestSlew()
+{
+    AxisFilter filter{ .type = FilterType::Slew, .rate = 10.f };
+
+    filter.Push(0.f, 0);
+    filter.Push(1.f, 10 * ms);
+    CHECK(std::abs(filter.value - 0.1f) < 1e-5f);
+
+    CHECK(filter.Advance(20 * ms));
+    CHECK(std::abs(filter.value - 0.2f) < 1e-5f);
+
+    uint64_t now = 20 * ms;
+    while (filter.Advance(now += 10 * ms) && now < 10'000 * ms) {}
+    CHECK(now <= 120 * ms);
+    CHECK(filter.value == 1.f);
+}
+
+static
+void TestOneEuro()
+{
+    AxisFilter filter{ .type = FilterType::OneEuro, .min_cutoff = 1.f, .beta = 0.5f };
+
+    filter.Push(0.f, 0);
+    filter.Push(1.f, 10 * ms);
+    CHECK(filter.value > 0.f && filter.value < 1.f);
+
+    uint64_t now = 10 * ms;
+    float last = filter.value;
+    bool monotonic = true;
+    while (filter.Advance(now += 10 * ms) && now < 100'000 * ms) {
+        monotonic &= filter.value >= last;
+        last = filter.value;
+    }
+    CHECK(monotonic);
+    CHECK(filter.value == 1.f);
+}
+
+int main()
+{
+    return RunTests({
+        { "median filter",   TestMedian },
+        { "ema filter",      TestEMA },
+        { "slew filter",     TestSlew },
+        { "one euro filter", TestOneEuro },
+    });
+}
@@ -0,0 +1,59 @@
+#include "test.hpp"
+
+// -----------------------------------------------------------------------------
+
+static
+void TestKeyNames()
+{
+    CHECK(KeyCodeFromName("ESC") == 1);
+    CHECK(KeyCodeFromName("A") == 30);
+    CHECK(KeyCodeFromName("F12") == 88);
+    CHECK(KeyCodeFromName("RIGHTMETA") == 126);
+    CHECK(KeyCodeFromName("0") == 11);
+}
+
+static
+void TestKeyNameForms()
+{
+    // Names match case insensitively, with or without the evdev prefix
+    CHECK(KeyCodeFromName("space") == 57);
+    CHECK(KeyCodeFromName("LeftShift") == 42);
+    CHECK(KeyCodeFromName("KEY_ENTER") == 28);
+    CHECK(KeyCodeFromName("KEY_kp5") == 76);
+
+    CHECK(!KeyCodeFromName(""));
+    CHECK(!KeyCodeFromName("KEY_"));
+    CHECK(!KeyCodeFromName("F13"));
+    CHECK(!KeyCodeFromName("ESCAPE"));
+    CHECK(!KeyCodeFromName(" A"));
+}
+
+static
+void TestKeyboardKeyCodes()
+{
+    CHECK(!IsKeyboardKeyCode(0));
+    CHECK(IsKeyboardKeyCode(1));
+    CHECK(IsKeyboardKeyCode(0xff));
+
+    // Button ranges are left out so the device is classified as a keyboard
+    CHECK(!IsKeyboardKeyCode(mouse_button_base_code));
+    CHECK(!IsKeyboardKeyCode(0x120));
+    CHECK(IsKeyboardKeyCode(0x160));
+    CHECK(!IsKeyboardKeyCode(0x2c0));
+    CHECK(IsKeyboardKeyCode(0x2e8));
+    CHECK(IsKeyboardKeyCode(max_key_code));
+    CHECK(!IsKeyboardKeyCode(max_key_code + 1));
+
+    for (auto name : { "ESC", "A", "F12", "RIGHTMETA" }) {
+        CHECK(IsKeyboardKeyCode(*KeyCodeFromName(name)));
+    }
+}
+
+int main()
+{
+    return RunTests({
+        { "key names",          TestKeyNames },
+        { "key name forms",     TestKeyNameForms },
+        { "keyboard key codes", TestKeyboardKeyCodes },
+    });
+}
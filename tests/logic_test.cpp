@@ -0,0 +1,201 @@
+#include "test.hpp"
+
+using namespace std::chrono_literals;
+
+// -----------------------------------------------------------------------------
+
+static
+LogicPrimitive MakePrimitive(LogicType type, uint32_t num_inputs)
+{
+    LogicPrimitive primitive{ .type = type };
+    primitive.held.resize(num_inputs);
+    return primitive;
+}
+
+static
+void TestToggle()
+{
+    auto now = std::chrono::steady_clock::now();
+    auto toggle = MakePrimitive(LogicType::Toggle, 1);
+
+    toggle.SetInput(0, true, now);
+    CHECK(toggle.output);
+    toggle.SetInput(0, true, now);
+    CHECK(toggle.output);
+    toggle.SetInput(0, false, now);
+    CHECK(toggle.output);
+    toggle.SetInput(0, true, now);
+    CHECK(!toggle.output);
+}
+
+static
+void TestChord()
+{
+    auto now = std::chrono::steady_clock::now();
+    auto chord = MakePrimitive(LogicType::Chord, 3);
+
+    chord.SetInput(0, true, now);
+    chord.SetInput(2, true, now);
+    CHECK(!chord.output);
+    chord.SetInput(1, true, now);
+    CHECK(chord.output);
+    chord.SetInput(0, false, now);
+    CHECK(!chord.output);
+}
+
+static
+void TestLayer()
+{
+    auto now = std::chrono::steady_clock::now();
+
+    auto held = MakePrimitive(LogicType::Layer, 3);
+    held.SetInput(0, true, now);
+    CHECK(held.layer == 1);
+    held.SetInput(2, true, now);
+    CHECK(held.layer == 3);
+    held.SetInput(2, false, now);
+    CHECK(held.layer == 1);
+    held.SetInput(0, false, now);
+    CHECK(held.layer == 0);
+    CHECK(!held.Value());
+
+    auto latched = MakePrimitive(LogicType::Layer, 3);
+    latched.latch = true;
+    latched.SetInput(1, true, now);
+    latched.SetInput(1, false, now);
+    CHECK(latched.layer == 2);
+    CHECK(latched.Value());
+    latched.SetInput(0, true, now);
+    latched.SetInput(0, false, now);
+    CHECK(latched.layer == 1);
+
+    // Pressing the selected layer again deselects it
+    latched.SetInput(0, true, now);
+    CHECK(latched.layer == 0);
+}
+
+static
+void TestPressDetector()
+{
+    auto now = std::chrono::steady_clock::now();
+
+    auto detector = MakePrimitive(LogicType::PressDetector, 1);
+    detector.long_press = 500ms;
+    detector.double_tap = 200ms;
+
+    // Long press, held past the deadline and never reported as a tap
+    detector.SetInput(0, true, now);
+    detector.Expire(now + 499ms);
+    CHECK(!detector.output);
+    detector.Expire(now + 500ms);
+    CHECK(detector.output);
+    detector.SetInput(0, false, now + 600ms);
+    CHECK(!detector.output && !detector.tapped);
+
+    // Single tap, reported once the double tap window closes
+    now += 1s;
+    detector.SetInput(0, true, now);
+    detector.SetInput(0, false, now + 50ms);
+    CHECK(!detector.tapped);
+    detector.Expire(now + 250ms);
+    CHECK(detector.tapped && !detector.double_tapped);
+    detector.tapped = false;
+
+    // Double tap
+    now += 1s;
+    detector.SetInput(0, true, now);
+    detector.SetInput(0, false, now + 50ms);
+    detector.SetInput(0, true, now + 100ms);
+    detector.SetInput(0, false, now + 150ms);
+    CHECK(detector.double_tapped && !detector.tapped);
+    CHECK(!detector.deadline);
+
+    // Without a double tap window taps are reported on release
+    auto single = MakePrimitive(LogicType::PressDetector, 1);
+    single.long_press = 500ms;
+    single.SetInput(0, true, now);
+    single.SetInput(0, false, now + 10ms);
+    CHECK(single.tapped);
+}
+
+static
+void TestShift()
+{
+    auto now = std::chrono::steady_clock::now();
+    auto shift = MakePrimitive(LogicType::Shift, 2);
+
+    shift.SetInput(1, true, now);
+    CHECK(shift.output && !shift.shifted);
+    shift.SetInput(1, false, now);
+    CHECK(!shift.output && !shift.shifted);
+
+    // The modifier is sampled on press, releasing it first keeps the input shifted
+    shift.SetInput(0, true, now);
+    shift.SetInput(1, true, now);
+    CHECK(!shift.output && shift.shifted);
+    shift.SetInput(0, false, now);
+    CHECK(shift.shifted);
+    shift.SetInput(1, false, now);
+    CHECK(!shift.shifted);
+}
+
+static
+void TestGraph()
+{
+    auto now = std::chrono::steady_clock::now();
+
+    InputDevice device;
+    auto key = [&](uint32_t code) {
+        return LogicInput{ .source = LogicSource::DeviceKey, .device = uint64_t(uintptr_t(&device)), .index = code };
+    };
+
+    LogicGraph graph;
+    Defer _ = [&] { graph.Clear(); };
+
+    // Toggle driven by a chord of two keys, the chord's edges propagate to the toggle
+    auto chord = graph.Create({ .type = LogicType::Chord, .inputs = { key(29), key(30) } });
+    auto toggle = graph.Create({ .type = LogicType::Toggle, .inputs = {
+        { .source = LogicSource::Primitive, .device = uint64_t(uintptr_t(chord)) },
+    }});
+    auto detector = graph.Create({ .type = LogicType::PressDetector, .inputs = { key(57) }, .long_press = 300ms });
+
+    device.state.keys[29] = true;
+    CHECK(!graph.Evaluate({}, now));
+    CHECK(!chord->output && !toggle->output);
+
+    device.state.keys[30] = true;
+    graph.Evaluate({}, now);
+    CHECK(chord->output && toggle->output);
+
+    device.state.keys[30] = false;
+    graph.Evaluate({}, now);
+    CHECK(!chord->output && toggle->output);
+
+    // A key pressed and released within one frame is still seen as a tap
+    device.state.pressed[57] = true;
+    graph.Evaluate({}, now);
+    CHECK(detector->tapped);
+    graph.EndFrame();
+    CHECK(!detector->tapped);
+    device.state.pressed.reset();
+
+    // Armed timers are returned so the engine can wake for them
+    device.state.keys[57] = true;
+    auto next = graph.Evaluate({}, now);
+    CHECK(next && *next == now + 300ms);
+    CHECK(!detector->output);
+    CHECK(!graph.Evaluate({}, now + 300ms));
+    CHECK(detector->output);
+}
+
+int main()
+{
+    return RunTests({
+        { "logic toggle",         TestToggle },
+        { "logic chord",          TestChord },
+        { "logic layer",          TestLayer },
+        { "logic press detector", TestPressDetector },
+        { "logic shift",          TestShift },
+        { "logic graph",          TestGraph },
+    });
+}
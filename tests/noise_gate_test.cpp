@@ -0,0 +1,103 @@
+#include "test.hpp"
+
+// -----------------------------------------------------------------------------
+
+static
+void TestNoiseGateThreshold()
+{
+    int owner;
+    NoiseGates gates;
+
+    // Without gates every event passes untouched
+    CHECK(gates.Filter(1, 0, 1234) == 1234);
+
+    gates.Set(1, 0, { .threshold = 100, .owner = &owner });
+    CHECK(gates.Filter(1, 0, 1000) == 1000);
+    CHECK(!gates.Filter(1, 0, 1050));
+    CHECK(!gates.Filter(1, 0, 900));
+    CHECK(gates.Filter(1, 0, 1101) == 1101);
+    CHECK(gates.Read(1, 0, 1150) == 1101);
+
+    // Other axes are not gated
+    CHECK(gates.Filter(1, 1, 5) == 5);
+
+    auto& axis = gates.axes.at((uint64_t(1) << 16) | 0);
+    CHECK(axis.raw_events == 4);
+    CHECK(axis.gated_events == 2);
+    CHECK(gates.gated_events == 2);
+    CHECK(gates.raw_events == 6);
+}
+
+static
+void TestNoiseGateFullScale()
+{
+    int owner;
+    NoiseGates gates;
+    gates.Set(1, 0, { .threshold = 200, .owner = &owner });
+
+    CHECK(gates.Filter(1, 0, 32700) == 32700);
+    CHECK(gates.Filter(1, 0, 32767) == 32767);
+    CHECK(!gates.Filter(1, 0, 32767));
+    CHECK(gates.Filter(1, 0, -32600) == -32600);
+    CHECK(gates.Filter(1, 0, -32768) == -32768);
+}
+
+static
+void TestNoiseGateCalibration()
+{
+    int owner;
+    NoiseGates gates;
+    gates.Set(2, NoiseGates::any_axis, { .threshold = 10, .offset = 500, .owner = &owner });
+
+    CHECK(gates.Filter(2, 3, -100) == 400);
+    CHECK(gates.Filter(2, 5, 32700) == 32767);
+    CHECK(gates.Read(2, 7, 0) == 500);
+
+    // Changing the gate restarts gating with the new calibration
+    CHECK(!gates.Filter(2, 3, -95));
+    gates.Set(2, NoiseGates::any_axis, { .threshold = 10, .offset = 0, .owner = &owner });
+    CHECK(gates.Filter(2, 3, -95) == -95);
+}
+
+static
+void TestNoiseGateOwners()
+{
+    int a, b;
+    NoiseGates gates;
+
+    gates.Set(1, 0, { .threshold = 10, .owner = &a });
+    gates.Set(2, NoiseGates::any_axis, { .threshold = 10, .owner = &a });
+
+    // Overlapping gates from another owner are rejected, device wide gates overlap every axis
+    CHECK_THROWS(gates.Set(1, 0, { .owner = &b }));
+    CHECK_THROWS(gates.Set(1, NoiseGates::any_axis, { .owner = &b }));
+    CHECK_THROWS(gates.Set(2, 4, { .owner = &b }));
+    gates.Set(1, 1, { .threshold = 10, .owner = &b });
+    gates.Set(1, 0, { .threshold = 20, .owner = &a });
+    CHECK(gates.gates.size() == 3);
+
+    gates.Filter(1, 0, 0);
+    gates.Filter(1, 1, 0);
+    gates.Filter(2, 0, 0);
+
+    gates.RemoveOwner(&a);
+    CHECK(gates.gates.size() == 1);
+    CHECK(gates.axes.size() == 1);
+    CHECK(gates.Filter(1, 0, 5) == 5);
+    CHECK(!gates.Filter(1, 1, 5));
+
+    gates.RemoveJoystick(1);
+    CHECK(gates.gates.empty());
+    CHECK(gates.axes.empty());
+    CHECK(gates.Filter(1, 1, 5) == 5);
+}
+
+int main()
+{
+    return RunTests({
+        { "noise gate threshold",   TestNoiseGateThreshold },
+        { "noise gate full scale",  TestNoiseGateFullScale },
+        { "noise gate calibration", TestNoiseGateCalibration },
+        { "noise gate owners",      TestNoiseGateOwners },
+    });
+}
@@ -0,0 +1,155 @@
+#include "test.hpp"
+
+#include <cstdlib>
+#include <cstring>
+
+// -----------------------------------------------------------------------------
+
+// Stores are keyed on the script path inside MAPPER_STATE_DIR, which main
+// points at a temporary directory
+static
+std::filesystem::path TestScriptPath(std::string_view name)
+{
+    return std::filesystem::temp_directory_path() / std::format("mapper-test-{}.lua", name);
+}
+
+static
+double GetNumber(PersistentStore* store, std::string_view key)
+{
+    auto value = store->Get(key);
+    auto number = std::get_if<double>(&value);
+    return number ? *number : -1.0;
+}
+
+static
+void TestValues()
+{
+    auto script = TestScriptPath("values");
+
+    auto store = OpenPersistentStore(script);
+    store->Set("number", 2.5);
+    store->Set("flag", true);
+    store->Set("name", std::string_view("throttle"));
+    store->Set("missing", std::monostate{});
+    ClosePersistentStore(store);
+
+    store = OpenPersistentStore(script);
+    CHECK(GetNumber(store, "number") == 2.5);
+    CHECK(store->Get("flag") == PersistentValue(true));
+    CHECK(store->Get("name") == PersistentValue(std::string_view("throttle")));
+    CHECK(std::holds_alternative<std::monostate>(store->Get("missing")));
+    CHECK(!store->index.contains("missing"));
+
+    // Clearing a key keeps its entry, the value reads back as nil
+    store->Set("number", std::monostate{});
+    CHECK(std::holds_alternative<std::monostate>(store->Get("number")));
+
+    CHECK_THROWS(store->Set(std::string(persistent_max_key + 1, 'k'), 1.0));
+    CHECK_THROWS(store->Set("name", std::string_view(std::string(persistent_max_string + 1, 's'))));
+    CHECK(store->Get("name") == PersistentValue(std::string_view("throttle")));
+    ClosePersistentStore(store);
+}
+
+static
+void TestSlotRecovery()
+{
+    auto script = TestScriptPath("recovery");
+
+    // A new key takes entry 0, its writes alternate between the two slots
+    auto store = OpenPersistentStore(script);
+    store->Set("value", 1.0);
+    store->Set("value", 2.0);
+    auto& entry = store->file->entries[0];
+    CHECK(entry.slots[0].generation == 1);
+    CHECK(entry.slots[1].generation == 2);
+    ClosePersistentStore(store);
+
+    store = OpenPersistentStore(script);
+    CHECK(GetNumber(store, "value") == 2.0);
+
+    // Damage the newest slot, reopening falls back to the previous value
+    store->file->entries[0].slots[1].number = 3.0;
+    ClosePersistentStore(store);
+
+    store = OpenPersistentStore(script);
+    CHECK(GetNumber(store, "value") == 1.0);
+
+    // The next write replaces the damaged slot and wins on the following open
+    store->Set("value", 4.0);
+    CHECK(store->file->entries[0].slots[1].generation == 2);
+    ClosePersistentStore(store);
+
+    store = OpenPersistentStore(script);
+    CHECK(GetNumber(store, "value") == 4.0);
+
+    // A write interrupted before its checksum was stored is ignored
+    store->Set("value", 5.0);
+    store->file->entries[0].slots[0].checksum = 0;
+    ClosePersistentStore(store);
+
+    store = OpenPersistentStore(script);
+    CHECK(GetNumber(store, "value") == 4.0);
+
+    // With both slots damaged the key is dropped and its entry reused
+    store->file->entries[0].slots[0].key[0] ^= 1;
+    store->file->entries[0].slots[1].key[0] ^= 1;
+    ClosePersistentStore(store);
+
+    store = OpenPersistentStore(script);
+    CHECK(store->index.empty());
+    store->Set("other", 6.0);
+    CHECK(store->index.size() == 1 && store->index.begin()->second == 0);
+    ClosePersistentStore(store);
+}
+
+static
+void TestIncompatibleLayout()
+{
+    auto script = TestScriptPath("layout");
+
+    auto store = OpenPersistentStore(script);
+    store->Set("value", 1.0);
+    store->file->slot_size = 32;
+    ClosePersistentStore(store);
+
+    store = OpenPersistentStore(script);
+    CHECK(store->index.empty());
+    CHECK(store->file->slot_size == sizeof(PersistentSlot));
+    CHECK(std::memcmp(store->file->magic, persistent_magic, sizeof(persistent_magic)) == 0);
+    ClosePersistentStore(store);
+}
+
+static
+void TestFull()
+{
+    auto script = TestScriptPath("full");
+
+    auto store = OpenPersistentStore(script);
+    for (uint32_t i = 0; i < persistent_capacity; ++i) {
+        store->Set(std::format("key{}", i), double(i));
+    }
+
+    // Duplicate keys in the file leave the index smaller than the number of used entries
+    store->index.erase("key0");
+    CHECK_THROWS(store->Set("extra", 1.0));
+    ClosePersistentStore(store);
+}
+
+int main()
+{
+    auto state_dir = std::filesystem::temp_directory_path()
+        / std::format("mapper-test-state-{}", std::chrono::steady_clock::now().time_since_epoch().count());
+#ifdef _WIN32
+    _putenv_s("MAPPER_STATE_DIR", state_dir.string().c_str());
+#else
+    setenv("MAPPER_STATE_DIR", state_dir.c_str(), 1);
+#endif
+    Defer _ = [&] { std::filesystem::remove_all(state_dir); };
+
+    return RunTests({
+        { "persistent values",            TestValues },
+        { "persistent slot recovery",     TestSlotRecovery },
+        { "persistent incompatible file", TestIncompatibleLayout },
+        { "persistent full",              TestFull },
+    });
+}
@@ -0,0 +1,87 @@
+#include "test.hpp"
+
+#include <memory>
+#include <thread>
+
+// -----------------------------------------------------------------------------
+
+struct Pair
+{
+    uint64_t a;
+    uint64_t b;
+};
+
+static
+void TestSeqLockRead()
+{
+    SeqLocked<Pair> locked;
+
+    Pair out;
+    CHECK(locked.TryRead(out) == 0);
+
+    locked.Write([](Pair& value) { value = { 1, 2 }; });
+    CHECK(locked.TryRead(out) == 2);
+    CHECK(out.a == 1 && out.b == 2);
+
+    // A write in progress is never read
+    locked.sequence.store(3);
+    CHECK(locked.TryRead(out, 4) == 0);
+}
+
+static
+void TestSeqLockConsistency()
+{
+    auto locked = std::make_unique<SeqLocked<Pair>>();
+    locked->Write([](Pair& value) { value = {}; });
+
+    std::atomic<bool> done = false;
+    std::thread writer([&] {
+        for (uint64_t i = 1; i <= 200'000; ++i) {
+            locked->Write([&](Pair& value) { value = { i, ~i }; });
+        }
+        done = true;
+    });
+
+    // Every successful read observes both halves of the same write
+    uint32_t torn = 0;
+    uint32_t reads = 0;
+    while (!done) {
+        Pair out;
+        if (!locked->TryRead(out)) continue;
+        torn += out.b != ~out.a;
+        ++reads;
+    }
+    writer.join();
+
+    CHECK(reads > 0);
+    CHECK(torn == 0);
+}
+
+static
+void TestPlotRingWrap()
+{
+    auto ring = std::make_unique<PlotRing>();
+    ring->head = 0;
+
+    auto count = state_plot_capacity + 10;
+    for (uint32_t i = 0; i < count; ++i) {
+        ring->Push({ .time_ns = int64_t(i), .value = float(i), .generation = 1 });
+    }
+
+    CHECK(ring->head.load() == count);
+
+    // The oldest samples are overwritten in place
+    CHECK(ring->samples[0].time_ns == state_plot_capacity);
+    CHECK(ring->samples[9].time_ns == state_plot_capacity + 9);
+    CHECK(ring->samples[10].time_ns == 10);
+    CHECK(ring->samples[(count - 1) % state_plot_capacity].value == float(count - 1));
+}
+
+int main()
+{
+    return RunTests({
+        { "seqlock read",        TestSeqLockRead },
+        { "seqlock consistency", TestSeqLockConsistency },
+        { "plot ring wrap",      TestPlotRingWrap },
+    });
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include "mapper.hpp"
+
+#include <iostream>
+#include <cstdlib>
+
+// -----------------------------------------------------------------------------
+//          Test Harness
+// -----------------------------------------------------------------------------
+
+// Each test file is its own executable registered with ctest. Checks report the
+// failing expression and keep going, the process exits non-zero if any failed.
+
+inline uint32_t test_failures = 0;
+
+#define CHECK(expr) \
+    do { \
+        if (!(expr)) { \
+            ++test_failures; \
+            std::cerr << std::format("{}:{}: check failed: {}\n", __FILE__, __LINE__, #expr); \
+        } \
+    } while (0)
+
+#define CHECK_THROWS(expr) \
+    do { \
+        bool thrown = false; \
+        try { expr; } catch (const std::exception&) { thrown = true; } \
+        if (!thrown) { \
+            ++test_failures; \
+            std::cerr << std::format("{}:{}: expected exception: {}\n", __FILE__, __LINE__, #expr); \
+        } \
+    } while (0)
+
+struct TestCase
+{
+    const char* name;
+    void(*fn)();
+};
+
+inline
+int RunTests(std::initializer_list<TestCase> tests)
+{
+    // Keep routine engine logging out of the test output
+    log_level = LogLevel::Warn;
+    StartLogThread();
+
+    for (auto& test : tests) {
+        auto failures = test_failures;
+        try {
+            test.fn();
+        } catch (const std::exception& e) {
+            ++test_failures;
+            std::cerr << std::format("{}: unexpected exception: {}\n", test.name, e.what());
+        }
+        std::cout << std::format("{} {}\n", test_failures == failures ? "[PASS]" : "[FAIL]", test.name);
+    }
+
+    StopLogThread();
+    return test_failures ? EXIT_FAILURE : EXIT_SUCCESS;
+}